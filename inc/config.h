@@ -16,6 +16,25 @@
 /** Provide definitions for stuff on GL-SK board */
 #define _USE_GLSK_DEFINITIONS		1
 
+/**
+ * Make HD44780 driver use GL-SK LCD pins known at compile time instead of the ones set in
+ * sk_lcd object. Speeds up bit-bang, but limits driver to the on-board LCD only.
+ * Requires SK_USE_GLSK_DEFINITIONS
+ */
+#define _USE_LCD_STATIC_PINS		0
+
+/**
+ * Make :c:func:`sk_tick_delay_ms` sleep through the whole delay with SysTick reprogrammed
+ * to the deadline (see :c:func:`sk_tick_idle`) instead of waking up on every tick
+ */
+#define _USE_TICKLESS				0
+
+/**
+ * Keep contention counters (:c:type:`sk_lock_stats`) in every :c:type:`sk_ticketlock`.
+ * Counters are updated while lock is held, so they cost a few cycles per acquisition
+ */
+#define _USE_LOCK_STATS				1
+
 
 #if !defined(SK_USE_SIZE_OPTIMIZATIONS)
 #define SK_USE_SIZE_OPTIMIZATIONS	(_USE_SIZE_OPTIMIZATIONS)
@@ -24,3 +43,15 @@
 #if !defined(SK_USE_GLSK_DEFINITIONS)
 #define SK_USE_GLSK_DEFINITIONS	(_USE_GLSK_DEFINITIONS)
 #endif
+
+#if !defined(SK_USE_LCD_STATIC_PINS)
+#define SK_USE_LCD_STATIC_PINS	(_USE_LCD_STATIC_PINS)
+#endif
+
+#if !defined(SK_USE_TICKLESS)
+#define SK_USE_TICKLESS	(_USE_TICKLESS)
+#endif
+
+#if !defined(SK_USE_LOCK_STATS)
+#define SK_USE_LOCK_STATS	(_USE_LOCK_STATS)
+#endif
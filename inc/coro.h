@@ -0,0 +1,213 @@
+#pragma once
+/**
+ * libsk coroutines - stackless (protothread-style) coroutines
+ *
+ * Coroutine is a function, which may stop in the middle waiting for something (delay,
+ * flag, fifo data) and continue from the same place when called next time. This allows
+ * writing drivers as straight sequences of steps, while running many of them interleaved
+ * on a single stack, i.e. from super-loop or as :c:type:`sk_evloop_handler`.
+ *
+ * Coroutine state (:c:type:`sk_coro`) is only a few bytes: the place to continue from and
+ * the start and length of current delay. Implementation is based on switch statement, where each wait
+ * point is a case label. This has consequences:
+ *
+ *  - Local variables are NOT preserved across waits. Keep state in static variables or
+ *    in a context structure passed to coroutine.
+ *  - Only one wait point macro may be put on a single source line.
+ *  - `switch` statements can not enclose wait points within coroutine body.
+ *
+ * Example:
+ *
+ * .. code-block:: c
+ *
+ *    sk_coro_state blink(struct sk_coro *co)
+ *    {
+ *        SK_CORO_BEGIN(co);
+ *        while (1) {
+ *            sk_pin_toggle(sk_io_led_green);
+ *            SK_CORO_AWAIT_MS(co, 500);
+ *        }
+ *        SK_CORO_END(co);
+ *    }
+ */
+
+#include "macro.h"
+#include "delay.h"
+#include "sync.h"
+#include "tick.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** Coroutine state returned by coroutine function */
+enum sk_coro_state {
+	/** Coroutine is waiting and should be called again */
+	SK_CORO_WAITING = 0,
+	/** Coroutine has finished. Further calls return immediately until re-initialized */
+	SK_CORO_DONE = 1
+};
+
+typedef enum sk_coro_state sk_coro_state;
+
+
+/** Coroutine object. Initialize with :c:func:`sk_coro_init` or :c:macro:`SK_CORO_INITIALIZER` */
+struct sk_coro {
+	/** Private: source line of wait point to continue from, 0 to start from the beginning */
+	uint16_t __line;
+	/** Private: tick or cycle counter value at the start of current delay */
+	uint32_t __start;
+	/** Private: length of current delay in ticks or cycles. Computed once when delay starts */
+	uint32_t __len;
+};
+
+
+/** Line value marking finished coroutine. Intended for private use */
+#define __SK_CORO_DONELINE		0xFFFF
+
+
+/** Coroutine initializer to start from the beginning */
+#define SK_CORO_INITIALIZER		((struct sk_coro){ .__line = 0, .__start = 0, .__len = 0 })
+
+
+/** Initialize (or restart) coroutine */
+inline sk_attr_alwaysinline void sk_coro_init(struct sk_coro *co)
+{
+	co->__line = 0;
+}
+
+
+/** Return `true` if coroutine has finished */
+inline sk_attr_alwaysinline bool sk_coro_is_done(const struct sk_coro *co)
+{
+	return __SK_CORO_DONELINE == co->__line;
+}
+
+
+/** Start coroutine body. Must be paired with :c:macro:`SK_CORO_END` */
+#define SK_CORO_BEGIN(co)			\
+	switch ((co)->__line) {			\
+	case 0:
+
+
+/** End coroutine body. Coroutine is finished when it gets here */
+#define SK_CORO_END(co)				\
+	(co)->__line = __SK_CORO_DONELINE;	\
+	/* fall through */			\
+	case __SK_CORO_DONELINE:		\
+		;				\
+	}					\
+	return SK_CORO_DONE
+
+
+/** Finish coroutine right away */
+#define SK_CORO_EXIT(co)			\
+	do {					\
+		(co)->__line = __SK_CORO_DONELINE;	\
+		return SK_CORO_DONE;		\
+	} while (0)
+
+
+/** Give control back once. Coroutine continues from here on the next call */
+#define SK_CORO_YIELD(co)			\
+	do {					\
+		(co)->__line = __LINE__;	\
+		return SK_CORO_WAITING;		\
+	case __LINE__:				\
+		;				\
+	} while (0)
+
+
+/** Wait until condition becomes true. Condition is checked on every call */
+#define SK_CORO_AWAIT(co, cond)			\
+	do {					\
+		(co)->__line = __LINE__;	\
+	case __LINE__:				\
+		if (!(cond))			\
+			return SK_CORO_WAITING;	\
+	} while (0)
+
+
+/**
+ * Wait for the specified number of system ticks (see :c:func:`sk_tick_get_current`).
+ * `nticks` is evaluated once, when wait starts
+ */
+#define SK_CORO_AWAIT_TICKS(co, nticks)					\
+	do {								\
+		(co)->__start = sk_tick_get_current();			\
+		(co)->__len = (nticks);					\
+		SK_CORO_AWAIT(co, (sk_tick_get_current() - (co)->__start) >= (co)->__len);	\
+	} while (0)
+
+
+/**
+ * Wait for the specified number of milliseconds. Resolution is one system tick.
+ * Conversion to ticks is done once, when wait starts
+ */
+#define SK_CORO_AWAIT_MS(co, ms)					\
+	SK_CORO_AWAIT_TICKS(co, __sk_coro_ms_to_ticks(ms))
+
+
+/**
+ * Wait for the specified number of CPU cycles (see :c:func:`sk_cycles_get_current`).
+ * Intended for short (microsecond) delays, i.e. in bit-bang drivers.
+ * `ncycles` is evaluated once, when wait starts
+ */
+#define SK_CORO_AWAIT_CYCLES(co, ncycles)				\
+	do {								\
+		(co)->__start = sk_cycles_get_current();		\
+		(co)->__len = (ncycles);				\
+		SK_CORO_AWAIT(co, (sk_cycles_get_current() - (co)->__start) >= (co)->__len);	\
+	} while (0)
+
+
+/**
+ * Wait until flag is set, then clear it.
+ * Flag is a `volatile bool` set i.e. from ISR. Settings coming while coroutine is not
+ * waiting on flag are merged into one
+ */
+#define SK_CORO_AWAIT_FLAG(co, flagptr)					\
+	do {								\
+		SK_CORO_AWAIT(co, *(flagptr));				\
+		*(flagptr) = false;					\
+	} while (0)
+
+
+/** Wait until `len` bytes are available in :c:type:`sk_bfifo_t` and get them into `buf` */
+#define SK_CORO_AWAIT_FIFO_GET(co, fifo, buf, len)			\
+	do {								\
+		SK_CORO_AWAIT(co, sk_bfifo_get_used(fifo) >= (len));	\
+		sk_bfifo_get((fifo), (buf), (len));			\
+	} while (0)
+
+
+/**
+ * Wait until there is space for `len` bytes in :c:type:`sk_bfifo_t` and put `buf` there
+ * @err: :c:type:`sk_err` lvalue receiving result of :c:func:`sk_bfifo_put`
+ *
+ * Only :c:macro:`SK_EFULL` is waited on. Other errors (i.e. :c:macro:`SK_ERANGE` when `len`
+ * exceeds fifo size and could never be put) end the wait at once, so check `err` right after.
+ * It is written in the same call where wait ends, so may be a local variable
+ */
+#define SK_CORO_AWAIT_FIFO_PUT(co, fifo, buf, len, err)		\
+	SK_CORO_AWAIT(co, SK_EFULL != ((err) = sk_bfifo_put((fifo), (buf), (len))))
+
+
+/**
+ * Start child coroutine and wait until it finishes
+ * @co: this coroutine
+ * @child: child coroutine object (:c:type:`sk_coro`)
+ * @call: child coroutine function call, i.e. ``lcd_init_coro(&child, lcd)``
+ */
+#define SK_CORO_SPAWN(co, child, call)					\
+	do {								\
+		sk_coro_init(child);					\
+		SK_CORO_AWAIT(co, SK_CORO_DONE == (call));		\
+	} while (0)
+
+
+/** Convert milliseconds to ticks rounding up. Intended for private use */
+inline sk_attr_alwaysinline uint32_t __sk_coro_ms_to_ticks(uint32_t ms)
+{
+	// rate * ms overflows 32 bits already at 1 kHz tick and ~50 days
+	return ((uint64_t)sk_get_tick_rate_hz() * ms + 999) / 1000;
+}
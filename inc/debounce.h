@@ -0,0 +1,192 @@
+#pragma once
+/**
+ * libsk debouncer - debounces all pins of a port in parallel using vertical counters
+ *
+ * Each pin has a 2-bit counter, but the counters are stored "vertically": bit 0 of all
+ * 16 counters of a port lives in one word and bit 1 in another. So all pins of a port are
+ * processed with a handful of bitwise operations per sample, regardless of how many pins
+ * change. A pin changes its debounced state after 4 consecutive samples differing from
+ * the current state (:c:macro:`SK_DEBOUNCE_NSAMPLES`). The number is fixed by counter width,
+ * use slower sampling for longer debounce time.
+ *
+ * Debounced changes are reported as press/release/long-press events put into a queue,
+ * which is filled from ISR and read from the main loop without locking.
+ *
+ * Typical use is sampling once per system tick, i.e. from overridden sys_tick_handler:
+ *
+ * .. code-block:: c
+ *
+ *    void sys_tick_handler(void)
+ *    {
+ *        __sk_tick_inc_callback();
+ *        sk_debounce_sample(&buttons);
+ *    }
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include "pin.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**
+ * Number of consecutive samples differing from debounced state needed to change it.
+ * Informational only: 2-bit counters wrap after exactly 4 samples, so this is not an option
+ */
+#if defined(SK_DEBOUNCE_NSAMPLES) && (SK_DEBOUNCE_NSAMPLES != 4)
+#error "SK_DEBOUNCE_NSAMPLES can not be changed. It is fixed at 4 by 2-bit vertical counters"
+#endif
+#define SK_DEBOUNCE_NSAMPLES	4
+
+
+/** Debouncer event types */
+enum sk_debounce_evtype {
+	/** Pin became active (pressed) */
+	SK_DEBOUNCE_PRESS = 0,
+	/** Pin became inactive (released) */
+	SK_DEBOUNCE_RELEASE = 1,
+	/** Pin stays active for :c:member:`sk_debounce.longpress` samples. Reported once per press */
+	SK_DEBOUNCE_LONGPRESS = 2
+};
+
+
+/** Debouncer event */
+struct sk_debounce_event {
+	/** Port value as :c:type:`sk_port` */
+	uint8_t port;
+	/** Pin number (0 .. 15) */
+	uint8_t pin;
+	/** Event type as :c:type:`sk_debounce_evtype` */
+	uint8_t type;
+};
+
+
+/**
+ * Set of debounced pins residing in the same port.
+ * Only :c:member:`sk_debounce_port.port`, :c:member:`sk_debounce_port.pins` and
+ * :c:member:`sk_debounce_port.inversions` are to be set by user, the rest is private state
+ */
+struct sk_debounce_port {
+	/** Port value as :c:type:`sk_port` */
+	uint8_t port;
+	/** 16-bit mask of debounced pins */
+	uint16_t pins;
+	/** 16-bit mask of pins which are active low (i.e. buttons shorting pin to ground) */
+	uint16_t inversions;
+	/** Private: debounced state, bit==1 means active */
+	uint16_t __state;
+	/** Private: vertical counter bit 0 */
+	uint16_t __cnt0;
+	/** Private: vertical counter bit 1 */
+	uint16_t __cnt1;
+	/** Private: active pins which already had long-press reported */
+	uint16_t __longdone;
+	/** Private: sample number at which each pin became active */
+	uint32_t __presstime[16];
+};
+
+
+/** Debouncer object */
+struct sk_debounce {
+	/** Array of debounced ports */
+	struct sk_debounce_port *ports;
+	/** Number of entries in :c:member:`sk_debounce.ports` */
+	uint8_t nports;
+	/** Long-press duration in samples. 0 disables long-press events */
+	uint32_t longpress;
+	/** Event queue buffer */
+	struct sk_debounce_event *evbuf;
+	/** Event queue buffer length. Queue holds up to `evlen - 1` events */
+	uint16_t evlen;
+	// Fields below are shared with ISR
+	/** Private: event queue read index. Only changed by reader */
+	volatile uint16_t __rdidx;
+	/** Private: event queue write index. Only changed by :c:func:`sk_debounce_sample` */
+	volatile uint16_t __wridx;
+	/** Private: number of samples taken so far */
+	uint32_t __nsamples;
+	/** Number of events dropped due to full queue */
+	volatile uint32_t nlost;
+};
+
+
+/**
+ * Initialize debouncer
+ * @db: debouncer object (:c:type:`sk_debounce`)
+ * @ports: array of :c:type:`sk_debounce_port` with port, pins and inversions set
+ * @nports: number of entries in `ports`
+ * @evbuf: event queue buffer
+ * @evlen: event queue buffer length. Must be at least 2
+ * @longpress: long-press duration in samples, or 0 to disable long-press events
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments
+ *
+ * Pins must already be configured as inputs. Initial debounced state is taken from the
+ * current pin levels, so pins held active during init do not produce press events.
+ */
+sk_err sk_debounce_init(struct sk_debounce *db, struct sk_debounce_port *ports, uint8_t nports,
+						struct sk_debounce_event *evbuf, uint16_t evlen, uint32_t longpress);
+
+
+/**
+ * Take one sample of all ports and update debounced states
+ * @db: debouncer object (:c:type:`sk_debounce`)
+ *
+ * Intended to be called at regular intervals (i.e. every 1 ms from SysTick ISR).
+ * Each port costs one IDR read and a few bitwise operations. Per-pin work is only done
+ * for pins which have just changed state or are waiting for long-press.
+ */
+void sk_debounce_sample(struct sk_debounce *db);
+
+
+/**
+ * Get next event from queue
+ * @db: debouncer object (:c:type:`sk_debounce`)
+ * @ev: pointer where to store event
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EEMPTY` if there are no events
+ *
+ * Safe to call while :c:func:`sk_debounce_sample` runs in ISR, as long as there is
+ * only one reader
+ */
+sk_err sk_debounce_get_event(struct sk_debounce *db, struct sk_debounce_event *ev);
+
+
+/** Return `true` if event relates to specified pin */
+inline sk_attr_alwaysinline bool sk_debounce_event_is(const struct sk_debounce_event *ev,
+													  sk_pin pin)
+{
+	return (ev->port == pin.port) && (ev->pin == pin.pin);
+}
+
+
+/**
+ * Return debounced state of port pins
+ * @dbport: debounced port (:c:type:`sk_debounce_port`)
+ * @return: 16-bit mask of pins which are currently active
+ */
+inline sk_attr_alwaysinline uint16_t sk_debounce_get_state(const struct sk_debounce_port *dbport)
+{
+	return dbport->__state;
+}
+
+
+#if SK_USE_GLSK_DEFINITIONS
+/**
+ * Initializer for array of :c:type:`sk_debounce_port` covering all GL-SK buttons
+ * (and STM32F4DISCOVERY user button), i.e.
+ * ``struct sk_debounce_port btn_ports[] = SK_DEBOUNCE_GLSK_PORTS;``
+ * Must be kept in sync with sk_io_btn_* definitions in pin.c
+ */
+#define SK_DEBOUNCE_GLSK_PORTS {							\
+	{										\
+		.port = SK_PORTA,							\
+		.pins = (1 << 0) | (1 << 15),		/* usr, mid */			\
+		.inversions = (1 << 15)							\
+	},										\
+	{										\
+		.port = SK_PORTC,							\
+		.pins = (1 << 6) | (1 << 8) | (1 << 9) | (1 << 11),	/* up, down, left, right */	\
+		.inversions = (1 << 6) | (1 << 8) | (1 << 9) | (1 << 11)		\
+	}										\
+}
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+/**
+ * libsk delay - busy-wait delays and cycle timestamps based on DWT cycle counter
+ *
+ * Cortex-M4 DWT unit has a 32-bit counter incremented every CPU cycle. Delays based on it
+ * do not depend on code alignment, flash wait states or compiler optimizations (as software
+ * loops do), and do not need any interrupts, so they are usable from ISRs.
+ *
+ * Counter wraps every 2^32 cycles (~25 s at 168 MHz). Timestamps should be compared
+ * by subtraction, i.e. ``(sk_cycles_get_current() - start) >= period``.
+ */
+
+#include "macro.h"
+#include <libopencm3/cm3/dwt.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**
+ * Enable DWT cycle counter
+ * @return: `true` on success, `false` if cycle counter is not implemented
+ *
+ * Safe to call many times. :c:func:`sk_delay_us` calls it itself when needed
+ */
+bool sk_delay_init(void);
+
+
+/** Return current DWT cycle counter value */
+inline sk_attr_alwaysinline uint32_t sk_cycles_get_current(void)
+{
+	return DWT_CYCCNT;
+}
+
+
+/**
+ * Busy-wait for the specified number of CPU cycles
+ * @cycles: number of cycles to wait
+ *
+ * Cycle counter must be enabled by :c:func:`sk_delay_init`
+ */
+inline sk_attr_alwaysinline void sk_delay_cycles(uint32_t cycles)
+{
+	uint32_t start = DWT_CYCCNT;
+	while ((DWT_CYCCNT - start) < cycles);
+}
+
+
+/**
+ * Busy-wait for the specified number of microseconds
+ * @us: number of microseconds to wait
+ *
+ * Calibrated from :c:data:`rcc_ahb_frequency`, rounding up, so the delay is never shorter
+ * than requested. Has the same signature as :c:type:`sk_delay_func_t`, so may be used
+ * as :c:member:`sk_lcd.delay_func_us`.
+ */
+void sk_delay_us(uint32_t us);
@@ -1,3 +1,4 @@
+#pragma once
 /**
  * libsk errors - provides definitions for all error codes in libsk
  *
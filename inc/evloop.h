@@ -0,0 +1,153 @@
+#pragma once
+/**
+ * libsk event loop - run-to-completion cooperative scheduler for bare-metal applications
+ *
+ * Work is split into handlers, which are run for events posted to them (from main context
+ * or from ISRs). Each handler runs to completion, so all handlers share one stack and there
+ * are no context switches. Handlers must not block: instead of waiting they post events
+ * or start software timers (see swtimer.h) and return.
+ *
+ * Events are queued per priority, queue 0 having the highest one. Loop always runs the
+ * oldest event of the highest non-empty queue. When there is nothing to do, MCU sleeps
+ * with WFI (or tickless idle, when timing wheel is attached) until an interrupt occurs.
+ *
+ * Run time of every handler is accounted in CPU cycles using DWT cycle counter.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include "swtimer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** Maximum number of priority queues */
+#define SK_EVLOOP_MAXQUEUES		8
+
+
+struct sk_evloop_handler;
+
+
+/**
+ * Handler function
+ * @handler: handler the event was posted to
+ * @param: event parameter given to :c:func:`sk_evloop_post`
+ */
+typedef void (*sk_evloop_func_t)(struct sk_evloop_handler *handler, uint32_t param);
+
+
+/** Event handler with run-time statistics */
+struct sk_evloop_handler {
+	/** Handler function */
+	sk_evloop_func_t func;
+	/** User data, i.e. pointer to handler state */
+	void *arg;
+	/** Priority as index of event queue (0 is the highest) */
+	uint8_t prio;
+	/** Number of times handler was run */
+	uint32_t nruns;
+	/** Total run time in CPU cycles */
+	uint64_t cycles;
+	/** Longest single run in CPU cycles */
+	uint32_t maxcycles;
+};
+
+
+/** Queued event. Intended for private use */
+struct sk_evloop_event {
+	struct sk_evloop_handler *handler;
+	uint32_t param;
+};
+
+
+/**
+ * Event queue of a single priority.
+ * Only :c:member:`sk_evloop_queue.buf` and :c:member:`sk_evloop_queue.len` are to be set
+ * by user
+ */
+struct sk_evloop_queue {
+	/** Event buffer */
+	struct sk_evloop_event *buf;
+	/** Event buffer length. Queue holds up to `len - 1` events */
+	uint16_t len;
+	/** Private: read index */
+	uint16_t __rdidx;
+	/** Private: write index */
+	uint16_t __wridx;
+	/** Number of events dropped due to full queue */
+	uint32_t nlost;
+};
+
+
+/** Event loop object */
+struct sk_evloop {
+	/** Array of priority queues */
+	struct sk_evloop_queue *queues;
+	/** Number of entries in :c:member:`sk_evloop.queues` */
+	uint8_t nqueues;
+	/** Timing wheel whose deferred timers are run by loop, or NULL */
+	struct sk_swtimer_wheel *wheel;
+	/** Total time spent sleeping in CPU cycles */
+	uint64_t idlecycles;
+	// Fields below are shared with ISRs
+	/** Private: bitmap of non-empty queues */
+	volatile uint8_t __pending;
+	/** Private: set by :c:func:`sk_evloop_stop` */
+	volatile bool __isstopped;
+};
+
+
+/**
+ * Initialize event loop
+ * @loop: event loop (:c:type:`sk_evloop`)
+ * @queues: array of queues with buf and len set. Index in array is queue priority
+ * @nqueues: number of queues (1 .. :c:macro:`SK_EVLOOP_MAXQUEUES`)
+ * @wheel: timing wheel to run deferred timers of, or NULL.
+ *         When set, idle MCU sleeps using :c:func:`sk_tick_idle` up to the nearest timer
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments
+ *
+ * Enables DWT cycle counter used for run-time accounting
+ */
+sk_err sk_evloop_init(struct sk_evloop *loop, struct sk_evloop_queue *queues, uint8_t nqueues,
+					  struct sk_swtimer_wheel *wheel);
+
+
+/**
+ * Post event to handler
+ * @loop: event loop (:c:type:`sk_evloop`)
+ * @handler: handler (:c:type:`sk_evloop_handler`) to run
+ * @param: parameter passed to handler as is
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_EFULL` if queue is full (event is dropped and counted)
+ *
+ * May be called from any context including ISRs
+ */
+sk_err sk_evloop_post(struct sk_evloop *loop, struct sk_evloop_handler *handler, uint32_t param);
+
+
+/**
+ * Run all expired deferred timer callbacks or, if there are none, at most one event.
+ * Never sleeps
+ * @loop: event loop (:c:type:`sk_evloop`)
+ * @return: `true` if something was run
+ *
+ * Allows incorporating loop into an existing super-loop
+ */
+bool sk_evloop_run_once(struct sk_evloop *loop);
+
+
+/**
+ * Run loop until :c:func:`sk_evloop_stop` is called
+ * @loop: event loop (:c:type:`sk_evloop`)
+ *
+ * Deferred timers of attached timing wheel are run before events of any priority
+ */
+void sk_evloop_run(struct sk_evloop *loop);
+
+
+/** Make :c:func:`sk_evloop_run` return after the current handler completes */
+inline sk_attr_alwaysinline void sk_evloop_stop(struct sk_evloop *loop)
+{
+	loop->__isstopped = true;
+}
@@ -0,0 +1,148 @@
+#pragma once
+/**
+ * libsk EXTI dispatcher - moves pin interrupt handling out of ISR
+ *
+ * EXTI ISR only timestamps the edge, reads pin level and puts an event into a lock-free
+ * queue. Handlers attached to pins are then called from main loop (or task) context by
+ * :c:func:`sk_exti_dispatch`, so they may take as long as they need without blocking
+ * other interrupts.
+ *
+ * Debounce is not done in ISR either. On the first edge the EXTI line is masked, and it is
+ * only unmasked after the debounce time elapses. Debounce time is counted in system ticks,
+ * so :c:func:`__sk_exti_tick_callback` must be called from tick ISR when debounce is used:
+ *
+ * .. code-block:: c
+ *
+ *    void sys_tick_handler(void)
+ *    {
+ *        __sk_tick_inc_callback();
+ *        __sk_exti_tick_callback();
+ *    }
+ *
+ * Timestamps are taken from DWT cycle counter (see :c:func:`sk_cycles_get_current`), which is
+ * enabled by :c:func:`sk_exti_init`.
+ *
+ * EXTI lines are shared between ports: line N serves pin N of one port only.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include "pin.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** Edges to generate events on. Inversion of :c:type:`sk_pin` is taken into account */
+enum sk_exti_edge {
+	/** Pin value becomes 1 */
+	SK_EXTI_ACTIVATE = 0,
+	/** Pin value becomes 0 */
+	SK_EXTI_DEACTIVATE = 1,
+	/** Both edges */
+	SK_EXTI_BOTH = 2
+};
+
+
+/** EXTI event */
+struct sk_exti_event {
+	/** DWT cycle counter value at the moment ISR was entered */
+	uint32_t time;
+	/** Port value as :c:type:`sk_port` */
+	uint8_t port;
+	/** Pin number (0 .. 15), which is the same as EXTI line number */
+	uint8_t pin;
+	/** Pin value read in ISR (with inversion taken into account) */
+	uint8_t value;
+	/** Private: set when queue slot holds complete event */
+	volatile uint8_t __ready;
+};
+
+
+/**
+ * EXTI event handler. Called from :c:func:`sk_exti_dispatch`
+ * @ev: event
+ * @arg: argument given to :c:func:`sk_exti_attach`
+ */
+typedef void (*sk_exti_handler_t)(const struct sk_exti_event *ev, void *arg);
+
+
+/**
+ * Initialize EXTI dispatcher
+ * @evbuf: event queue buffer
+ * @evlen: event queue buffer length (2 .. 255). Queue holds up to `evlen - 1` events
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments
+ *
+ * Detaches all pins previously attached
+ */
+sk_err sk_exti_init(struct sk_exti_event *evbuf, uint8_t evlen);
+
+
+/**
+ * Attach pin to its EXTI line
+ * @pin: pin (:c:type:`sk_pin`). Must already be configured as input
+ * @edge: edges to generate events on (:c:type:`sk_exti_edge`)
+ * @debounce: debounce time in system ticks. 0 disables debounce
+ * @handler: handler called from :c:func:`sk_exti_dispatch`. May be NULL if events are read
+ *           with :c:func:`sk_exti_get_event`
+ * @arg: argument passed to `handler` as is
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_EUNAVAILABLE` if EXTI line is already used by pin of another port
+ *
+ * With debounce, an event is generated on the first edge. Further edges are ignored until
+ * debounce time elapses. Then pin is read again, and if its value differs from the one
+ * reported, another event is generated, so that final pin state is never lost.
+ */
+sk_err sk_exti_attach(sk_pin pin, enum sk_exti_edge edge, uint32_t debounce,
+					  sk_exti_handler_t handler, void *arg);
+
+
+/** Detach pin from its EXTI line. Events already queued are still delivered */
+void sk_exti_detach(sk_pin pin);
+
+
+/**
+ * Get next event from queue
+ * @ev: pointer where to store event
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EEMPTY` if there are no events
+ *
+ * Only one context may read events. Handlers are not called
+ */
+sk_err sk_exti_get_event(struct sk_exti_event *ev);
+
+
+/**
+ * Call handlers for all queued events
+ * @return: number of events processed
+ *
+ * Intended to be called from main loop or task. Only one context may dispatch events
+ */
+uint32_t sk_exti_dispatch(void);
+
+
+/** Return number of events dropped due to full queue */
+uint32_t sk_exti_get_nlost(void);
+
+
+/** Debounce timing callback. Must be called from tick ISR when debounce is used */
+void __sk_exti_tick_callback(void);
+
+
+/**
+ * EXTI lines callback. Intended for private use
+ * @lines: mask of EXTI lines served by calling ISR
+ */
+void __sk_exti_callback(uint32_t lines);
+
+
+/**
+ * Default EXTI ISRs used by dispatcher.
+ * User may override them, but should call :c:func:`__sk_exti_callback` from there
+ */
+void sk_attr_weak exti0_isr(void);
+void sk_attr_weak exti1_isr(void);
+void sk_attr_weak exti2_isr(void);
+void sk_attr_weak exti3_isr(void);
+void sk_attr_weak exti4_isr(void);
+void sk_attr_weak exti9_5_isr(void);
+void sk_attr_weak exti15_10_isr(void);
@@ -0,0 +1,139 @@
+#pragma once
+/**
+ * libsk input capture - frequency, period and pulse width measurement on timer channels
+ *
+ * Timer runs free and captures input edges. Each rising edge of the measured channel issues
+ * one DMA burst request, which copies both rising (measured channel) and falling (its paired
+ * channel, fed from the same input) capture registers into a RAM ring. So edges are captured
+ * without interrupt per edge. The ring is processed in DMA half/complete transfer and timer
+ * overflow interrupts, where captures are extended with overflow count and accumulated.
+ *
+ * Channels come in pairs (1-2 and 3-4). Measuring one of them takes the other one as well.
+ *
+ * Supported timers are those with DMA requests: TIM1, TIM2, TIM3, TIM4 (except CH4), TIM5,
+ * TIM8. Input pin must be configured to timer alternate function by user.
+ * Note that :c:func:`sk_lacap_init` uses TIM1 and :c:func:`sk_wave_init` uses TIM8.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** Accumulated measurement, returned by :c:func:`sk_icap_read` */
+struct sk_icap_result {
+	/** Timer tick rate in Hz */
+	uint32_t tick_hz;
+	/** Number of complete periods accumulated */
+	uint32_t nperiods;
+	/** Sum of period durations in ticks */
+	uint64_t sumperiod;
+	/** Sum of high pulse durations in ticks */
+	uint64_t sumwidth;
+	/** The most recent period duration in ticks */
+	uint32_t lastperiod;
+	/** The most recent high pulse duration in ticks */
+	uint32_t lastwidth;
+};
+
+
+/** Input capture object */
+struct sk_icap {
+	/** Ring buffer for raw capture pairs */
+	uint32_t *buf;
+	/** Ring buffer length in words. Must be multiple of 4 */
+	uint16_t len;
+	/** Timer channel (1 .. 4) */
+	uint8_t channel;
+	/** Timer base address as in libopencm3 */
+	uint32_t tim;
+	/** Actual tick rate, which may differ from requested due to prescaler resolution */
+	uint32_t tick_hz;
+	/** Private: index into timer descriptor table */
+	uint8_t __timidx;
+	/** Private: counter mask (timer maximum value) */
+	uint32_t __mask;
+	/** Private: ring read position in words */
+	uint16_t __rpos;
+	/** Private: extended time of the current counter overflow period start */
+	uint64_t __base;
+	/** Private: extended time of the last rising edge */
+	uint64_t __lastrise;
+	/** Private: whether :c:member:`sk_icap.__lastrise` is valid */
+	bool __hasrise;
+	/** Private: accumulated measurement */
+	struct sk_icap_result __res;
+	/** Private: set while capture is running */
+	volatile bool __isrunning;
+};
+
+
+/**
+ * Initialize input capture
+ * @ic: capture object (:c:type:`sk_icap`)
+ * @tim: timer base address as in libopencm3 (TIM1 .. TIM5, TIM8)
+ * @channel: timer channel (1 .. 4). Signal is taken from this channel's input
+ * @buf: ring buffer for captures. Two words are stored per signal period
+ * @len: ring buffer length in words. Must be multiple of 4
+ * @tick_hz: desired timer tick rate, i.e. time resolution
+ * @irq_priority: priority for both timer and DMA interrupts
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_EUNAVAILABLE` if there is no DMA request for timer channel,
+ *          :c:macro:`SK_ERANGE` if tick rate can not be reached with current clock settings
+ *
+ * Timer and DMA interrupts are enabled in NVIC, but their ISRs are not provided, as resources
+ * are chosen at run time. User must call :c:func:`sk_icap_irq_handler` from both of them.
+ */
+sk_err sk_icap_init(struct sk_icap *ic, uint32_t tim, uint8_t channel, uint32_t *buf,
+					uint16_t len, uint32_t tick_hz, uint8_t irq_priority);
+
+
+/** Start capture. Accumulated measurement is reset */
+void sk_icap_start(struct sk_icap *ic);
+
+
+/** Stop capture */
+void sk_icap_stop(struct sk_icap *ic);
+
+
+/**
+ * Get measurement accumulated since the previous call (or start) and reset it
+ * @ic: capture object (:c:type:`sk_icap`)
+ * @res: pointer to result (:c:type:`sk_icap_result`)
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments
+ *
+ * Averaging over all periods between calls gives the best frequency resolution. So for
+ * 1 ppm resolution, call once per 10^6 timer ticks or more.
+ */
+sk_err sk_icap_read(struct sk_icap *ic, struct sk_icap_result *res);
+
+
+/**
+ * Return average signal frequency
+ * @res: measurement (:c:type:`sk_icap_result`)
+ * @millihz: pointer where to store fractional part in millihertz. May be NULL
+ * @return: integer part of frequency in Hz or 0 if no complete period was measured
+ */
+uint32_t sk_icap_get_freq_hz(const struct sk_icap_result *res, uint16_t *millihz);
+
+
+/**
+ * Return average duty cycle
+ * @res: measurement (:c:type:`sk_icap_result`)
+ * @return: duty cycle in 1/1000 (0 .. 1000) or 0 if no complete period was measured
+ */
+uint16_t sk_icap_get_duty_permille(const struct sk_icap_result *res);
+
+
+/**
+ * Process captures and timer overflow
+ * @ic: capture object (:c:type:`sk_icap`)
+ *
+ * Must be called from timer update ISR and from the ISR of DMA stream used by capture.
+ * Overflow extension is correct as long as timer interrupt is not delayed by more than the
+ * timer overflow period. Period is extended without limits, while pulse width is only valid
+ * while low pulse is shorter than the overflow period.
+ */
+void sk_icap_irq_handler(struct sk_icap *ic);
@@ -1,3 +1,4 @@
+#pragma once
 /**
  * libsk intrinsics
  *
@@ -6,6 +7,7 @@
  */
 
 #include "macro.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 
@@ -23,6 +25,16 @@ inline sk_attr_alwaysinline void __WFE(void)
 }
 
 
+/** SEV - Send Event
+ *
+ * Sets event register, so the next (or currently pending) WFE returns immediately
+ */
+inline sk_attr_alwaysinline void __SEV(void)
+{
+	__asm__ volatile ("sev" ::: "memory");
+}
+
+
 /** DMB - Data Memory Barrier
  *
  * The DMB instruction that all explicit data memory transfers before the DMB are completed
@@ -83,6 +95,64 @@ inline sk_attr_alwaysinline uint32_t __STREXB(uint8_t value, volatile uint8_t *a
 }
 
 
+/** LDREXH - LDR Exclusive (16 bit)
+ *  @addr: Pointer to 16 bit data
+ *  @return: Value pointed by `ptr`
+ *
+ * Executes a exclusive LDR instruction for 16 bit value
+ */
+inline sk_attr_alwaysinline uint16_t __LDREXH(volatile uint16_t *addr)
+{
+	uint32_t result;
+	__asm__ volatile ("ldrexh %0, %1" : "=r" (result) : "Q" (*addr) );
+	return ((uint16_t) result);
+}
+
+
+/** STREXH - STR Exclusive (16 bit)
+ *  @value: Value to store in address pointed by `addr`
+ *  @addr: Pointer to 16 bit data
+ *  @return: `0` if exclusive store succeded, `1` if failed
+ *
+ * Executes a exclusive STR instruction for 16 bit value
+ */
+inline sk_attr_alwaysinline uint32_t __STREXH(uint16_t value, volatile uint16_t *addr)
+{
+   uint32_t result;
+   __asm__ volatile ("strexh %0, %2, %1" : "=&r" (result), "=Q" (*addr) : "r" ((uint32_t)value) );
+   return(result);
+}
+
+
+/** LDREXW - LDR Exclusive (32 bit)
+ *  @addr: Pointer to 32 bit data
+ *  @return: Value pointed by `ptr`
+ *
+ * Executes a exclusive LDR instruction for 32 bit value
+ */
+inline sk_attr_alwaysinline uint32_t __LDREXW(volatile uint32_t *addr)
+{
+	uint32_t result;
+	__asm__ volatile ("ldrex %0, %1" : "=r" (result) : "Q" (*addr) );
+	return result;
+}
+
+
+/** STREXW - STR Exclusive (32 bit)
+ *  @value: Value to store in address pointed by `addr`
+ *  @addr: Pointer to 32 bit data
+ *  @return: `0` if exclusive store succeded, `1` if failed
+ *
+ * Executes a exclusive STR instruction for 32 bit value
+ */
+inline sk_attr_alwaysinline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr)
+{
+   uint32_t result;
+   __asm__ volatile ("strex %0, %2, %1" : "=&r" (result), "=Q" (*addr) : "r" (value) );
+   return(result);
+}
+
+
 /** CLREX - Clear Exclusive
  *
  * CLREX makes the next STREX instruction write 1 to its destination and fail to perform the store.
@@ -94,3 +164,113 @@ inline sk_attr_alwaysinline void __CLREX(void)
 {
   __asm__ volatile ("clrex" ::: "memory");
 }
+
+
+// Atomic operations
+//
+// Built on exclusives, so they never mask interrupts. Exclusive store fails when interrupt
+// is taken between LDREX and STREX (exception entry clears local monitor), and operation
+// is then retried.
+// All operations are sequentially consistent: DMB is placed before and after memory access,
+// which matches what GCC emits for __ATOMIC_SEQ_CST on ARMv7-M (see AN321 p. 4.19).
+//
+// Operations are generic over uint8_t, uint16_t and uint32_t (volatile or not) pointers, i.e.
+// ``sk_atomic_add(&stats.nerrors, 1)``. Read-modify-write operations return the old value.
+
+/** Define atomic operations for a single type. Intended for private use */
+#define __SK_ATOMIC_DEFINE(sfx, type, ldrex, strex)						\
+inline sk_attr_alwaysinline type __sk_atomic_load_##sfx(volatile type *ptr)			\
+{												\
+	type val = *ptr;									\
+	__DMB();										\
+	return val;										\
+}												\
+inline sk_attr_alwaysinline void __sk_atomic_store_##sfx(volatile type *ptr, type val)	\
+{												\
+	__DMB();										\
+	*ptr = val;										\
+	__DMB();										\
+}												\
+inline sk_attr_alwaysinline type __sk_atomic_xchg_##sfx(volatile type *ptr, type val)	\
+{												\
+	type old;										\
+	__DMB();										\
+	do {											\
+		old = ldrex(ptr);								\
+	} while (strex(val, ptr));								\
+	__DMB();										\
+	return old;										\
+}												\
+inline sk_attr_alwaysinline bool __sk_atomic_cas_##sfx(volatile type *ptr, type expected,	\
+							  type desired)			\
+{												\
+	__DMB();										\
+	do {											\
+		if (ldrex(ptr) != expected) {							\
+			__CLREX();								\
+			__DMB();								\
+			return false;								\
+		}										\
+	} while (strex(desired, ptr));								\
+	__DMB();										\
+	return true;										\
+}												\
+__SK_ATOMIC_DEFINE_RMW(sfx, type, ldrex, strex, add, +)					\
+__SK_ATOMIC_DEFINE_RMW(sfx, type, ldrex, strex, sub, -)					\
+__SK_ATOMIC_DEFINE_RMW(sfx, type, ldrex, strex, or, |)					\
+__SK_ATOMIC_DEFINE_RMW(sfx, type, ldrex, strex, and, &)
+
+
+/** Define atomic read-modify-write operation. Intended for private use */
+#define __SK_ATOMIC_DEFINE_RMW(sfx, type, ldrex, strex, name, op)				\
+inline sk_attr_alwaysinline type __sk_atomic_##name##_##sfx(volatile type *ptr, type val)	\
+{												\
+	type old;										\
+	__DMB();										\
+	do {											\
+		old = ldrex(ptr);								\
+	} while (strex((type)(old op val), ptr));						\
+	__DMB();										\
+	return old;										\
+}
+
+
+__SK_ATOMIC_DEFINE(u8, uint8_t, __LDREXB, __STREXB)
+__SK_ATOMIC_DEFINE(u16, uint16_t, __LDREXH, __STREXH)
+__SK_ATOMIC_DEFINE(u32, uint32_t, __LDREXW, __STREXW)
+
+
+/** Select atomic operation by pointer type. Intended for private use */
+#define __SK_ATOMIC_SELECT(name, ptr) _Generic((ptr),					\
+	uint8_t *: __sk_atomic_##name##_u8,    volatile uint8_t *: __sk_atomic_##name##_u8,	\
+	uint16_t *: __sk_atomic_##name##_u16,  volatile uint16_t *: __sk_atomic_##name##_u16,	\
+	uint32_t *: __sk_atomic_##name##_u32,  volatile uint32_t *: __sk_atomic_##name##_u32)
+
+
+/** Atomically read `*ptr` */
+#define sk_atomic_load(ptr)		__SK_ATOMIC_SELECT(load, ptr)(ptr)
+
+/** Atomically write `val` to `*ptr` */
+#define sk_atomic_store(ptr, val)	__SK_ATOMIC_SELECT(store, ptr)((ptr), (val))
+
+/** Atomically write `val` to `*ptr`. Return the old value */
+#define sk_atomic_xchg(ptr, val)	__SK_ATOMIC_SELECT(xchg, ptr)((ptr), (val))
+
+/**
+ * Atomically write `desired` to `*ptr` if it equals `expected`.
+ * Return `true` if value was written, `false` if `*ptr` differed from `expected`
+ */
+#define sk_atomic_cas(ptr, expected, desired)	\
+	__SK_ATOMIC_SELECT(cas, ptr)((ptr), (expected), (desired))
+
+/** Atomically add `val` to `*ptr`. Return the old value */
+#define sk_atomic_add(ptr, val)		__SK_ATOMIC_SELECT(add, ptr)((ptr), (val))
+
+/** Atomically subtract `val` from `*ptr`. Return the old value */
+#define sk_atomic_sub(ptr, val)		__SK_ATOMIC_SELECT(sub, ptr)((ptr), (val))
+
+/** Atomically OR `*ptr` with `val`. Return the old value */
+#define sk_atomic_or(ptr, val)		__SK_ATOMIC_SELECT(or, ptr)((ptr), (val))
+
+/** Atomically AND `*ptr` with `val`. Return the old value */
+#define sk_atomic_and(ptr, val)		__SK_ATOMIC_SELECT(and, ptr)((ptr), (val))
@@ -0,0 +1,169 @@
+#pragma once
+/**
+ * libsk logic analyzer capture - samples GPIO port input into RAM ring at MHz rates
+ *
+ * Timer update event paces DMA, which copies port IDR to the ring buffer. Without trigger
+ * capture runs with zero CPU load until stopped. With trigger, each half of the ring is scanned
+ * in DMA half/complete transfer ISR, and capture stops after the desired number of samples
+ * following the trigger was collected.
+ *
+ * Captured data may be exported as VCD (Value Change Dump), which is read by GTKWave,
+ * PulseView and Saleae Logic.
+ *
+ * Resources used: TIM1 (update event) and DMA2 Stream 5 Channel 6.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include "pin.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**
+ * Number of samples reserved between the end of post-trigger window and the trigger sample.
+ * Capture with trigger stops from DMA ISR, while DMA keeps writing to ring in circular mode.
+ * Samples written in the meantime overwrite the oldest ones, so ISR latency (including the
+ * trigger scan) must stay below this many sample periods for trigger sample to be kept.
+ * I.e. 64 samples at 10 MHz rate give 6.4 us.
+ */
+#define SK_LACAP_POSTTRIG_MARGIN	64
+
+
+/** Trigger condition. Trigger fires on sample where `(sample & mask) == value` */
+struct sk_lacap_trig {
+	/** 16-bit mask of pins taking part in condition */
+	uint16_t mask;
+	/** Expected values of pins specified in mask */
+	uint16_t value;
+	/** Fire only when condition becomes true (i.e. on edge), not while it stays true */
+	bool onenter;
+};
+
+
+/** Logic analyzer capture object */
+struct sk_lacap {
+	/** Ring buffer for samples. Each sample is the whole port IDR value */
+	uint16_t *buf;
+	/** Ring buffer length in samples. Must be even */
+	uint16_t len;
+	/** Port value as :c:type:`sk_port` */
+	uint8_t port;
+	/** Actual sample rate, which may differ from requested due to timer resolution */
+	uint32_t rate_hz;
+	// Fields below are shared with ISR
+	/** Private: trigger condition */
+	struct sk_lacap_trig __trig;
+	/** Private: whether trigger is used */
+	volatile bool __istrigused;
+	/** Private: set while capture is running */
+	volatile bool __isrunning;
+	/** Private: index of trigger sample or -1 */
+	volatile int32_t __trigidx;
+	/** Private: number of samples still to be captured after trigger */
+	volatile int32_t __postleft;
+	/** Private: index of the oldest sample after capture is stopped */
+	volatile uint16_t __start;
+	/** Private: whether previous sample matched trigger condition */
+	volatile bool __prevmatch;
+};
+
+
+/**
+ * Initialize capture
+ * @cap: capture object (:c:type:`sk_lacap`)
+ * @port: GPIO port to sample
+ * @buf: ring buffer for samples
+ * @len: ring buffer length in samples. Must be even and non-zero
+ * @rate_hz: desired sample rate. Actual one is stored in :c:member:`sk_lacap.rate_hz`
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if rate can not be reached with current clock settings
+ *
+ * Sampling does not change pin configuration, so pins used by other peripherals
+ * (i.e. SPI, I2C, LCD) may be sampled as well.
+ */
+sk_err sk_lacap_init(struct sk_lacap *cap, enum sk_port port, uint16_t *buf, uint16_t len,
+					 uint32_t rate_hz);
+
+
+/**
+ * Start capture
+ * @cap: capture object (:c:type:`sk_lacap`)
+ * @trig: trigger condition or NULL for free-running capture
+ * @posttrig: number of samples to capture after trigger.
+ *            With trigger must be <= `len / 2 - SK_LACAP_POSTTRIG_MARGIN`
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments
+ *
+ * With trigger, capture stops by itself at the end of ring half where `posttrig` samples
+ * following the trigger become available. So roughly `len / 2` or more samples before the
+ * trigger are kept in ring, minus the ones overwritten while stopping
+ * (see :c:macro:`SK_LACAP_POSTTRIG_MARGIN`).
+ * Without trigger, capture runs until :c:func:`sk_lacap_stop` is called.
+ */
+sk_err sk_lacap_start(struct sk_lacap *cap, const struct sk_lacap_trig *trig, uint16_t posttrig);
+
+
+/** Stop capture */
+void sk_lacap_stop(struct sk_lacap *cap);
+
+
+/** Return `true` while capture is running */
+inline sk_attr_alwaysinline bool sk_lacap_is_running(const struct sk_lacap *cap)
+{
+	return cap->__isrunning;
+}
+
+
+/**
+ * Return trigger sample position
+ * @cap: capture object (:c:type:`sk_lacap`)
+ * @return: index of trigger sample counted from the oldest sample in ring,
+ *          or -1 if trigger did not fire
+ */
+int32_t sk_lacap_get_trigger(const struct sk_lacap *cap);
+
+
+/**
+ * Return captured sample
+ * @cap: capture object (:c:type:`sk_lacap`)
+ * @idx: sample index counted from the oldest sample in ring (0 .. len - 1)
+ * @return: sample value
+ *
+ * Only valid after capture was stopped
+ */
+uint16_t sk_lacap_get_sample(const struct sk_lacap *cap, uint16_t idx);
+
+
+/** Output function used by exporters. Called for every output character */
+typedef void (*sk_lacap_out_func_t)(char ch, void *arg);
+
+
+/**
+ * Export captured data in VCD (Value Change Dump) format
+ * @cap: capture object (:c:type:`sk_lacap`)
+ * @pins: 16-bit mask of pins to export
+ * @names: array of 16 signal names, one per pin. May be NULL or contain NULLs to use
+ *         default names like "PE12"
+ * @out: output function, i.e. putting chars to UART or semihosting file
+ * @arg: argument passed to `out` as is
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_EUNAVAILABLE` if capture is still running
+ *
+ * Time is given in nanoseconds starting from the oldest sample. Trigger time (if trigger
+ * fired) is put into VCD header comment.
+ */
+sk_err sk_lacap_export_vcd(const struct sk_lacap *cap, uint16_t pins, const char *const *names,
+						   sk_lacap_out_func_t out, void *arg);
+
+
+/**
+ * Default DMA2 Stream 5 ISR used by capture for trigger detection.
+ * User may override it, but should call :c:func:`__sk_lacap_dma_callback` from there.
+ */
+void sk_attr_weak dma2_stream5_isr(void);
+
+
+/** DMA half/complete transfer callback. Intended for private use */
+void __sk_lacap_dma_callback(void);
@@ -30,7 +30,7 @@ struct sk_lcd {
       * (0 for OFF and != 0 for ON) */
 	void (*set_backlight_func)(uint8_t);
 	/** Pointer to user-provided delay function with microsecond resolution.
-	  * Set to NULL to use ms delay as a fallback */
+	  * Set to NULL to use :c:func:`sk_delay_us` */
 	sk_delay_func_t delay_func_us;
 	/** Pointer to user-provided delay function with millisecond resolution.
       * Set to NULL to use us delay as a fallback */
@@ -0,0 +1,81 @@
+#pragma once
+/**
+ * libsk lock-free bounded multi-producer multi-consumer queue
+ *
+ * Each slot carries a sequence number, which tells whether slot is free for position being
+ * put or holds element for position being taken (see D. Vyukov's bounded MPMC queue).
+ * Positions are claimed with 32-bit LDREX/STREX, so no locks are taken and interrupts are never
+ * masked. Put and get never wait for other contexts, which makes the queue safe for any number
+ * of ISRs of any priority and the main loop.
+ *
+ * When put or get is preempted after position was claimed, but before slot is completed,
+ * slot is not yet visible to the other side. So queue may briefly report
+ * :c:macro:`SK_EFULL` or :c:macro:`SK_EEMPTY` while holding free slots or elements.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include <stdint.h>
+
+
+/** MPMC queue object */
+struct sk_mpmc {
+	/** Element storage, `len` elements of :c:member:`sk_mpmc.elsize` bytes each */
+	uint8_t *buf;
+	/** Private: per-slot sequence numbers */
+	volatile uint32_t *__seq;
+	/** Private: number of slots minus one. Number of slots is a power of two */
+	uint32_t __mask;
+	/** Element size in bytes */
+	uint16_t elsize;
+	/** Private: next position to put */
+	volatile uint32_t __head;
+	/** Private: next position to get */
+	volatile uint32_t __tail;
+};
+
+typedef struct sk_mpmc sk_mpmc;
+
+
+/**
+ * Initialize queue
+ * @q: queue object (:c:type:`sk_mpmc`)
+ * @buf: element storage of `len * elsize` bytes
+ * @seq: array of `len` sequence numbers
+ * @len: number of slots. Must be a power of two (2 .. 2^31)
+ * @elsize: element size in bytes
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments
+ *
+ * Must not race with put and get
+ */
+sk_err sk_mpmc_init(sk_mpmc *q, void *buf, uint32_t *seq, uint32_t len, uint16_t elsize);
+
+
+/**
+ * Put element into queue
+ * @q: queue object (:c:type:`sk_mpmc`)
+ * @el: pointer to element of :c:member:`sk_mpmc.elsize` bytes
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EFULL` if queue is full
+ */
+sk_err sk_mpmc_put(sk_mpmc *q, const void *el);
+
+
+/**
+ * Get element from queue
+ * @q: queue object (:c:type:`sk_mpmc`)
+ * @el: pointer where to store element of :c:member:`sk_mpmc.elsize` bytes
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EEMPTY` if queue is empty
+ */
+sk_err sk_mpmc_get(sk_mpmc *q, void *el);
+
+
+/**
+ * Return number of elements in queue. Only an estimate while queue is used concurrently
+ */
+inline sk_attr_alwaysinline uint32_t sk_mpmc_get_used(const sk_mpmc *q)
+{
+	uint32_t tail = q->__tail;
+	uint32_t used = q->__head - tail;
+	// tail read first, so head may only be ahead. Puts claimed but not completed yet count
+	return (used > q->__mask + 1) ? q->__mask + 1 : used;
+}
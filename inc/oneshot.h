@@ -0,0 +1,102 @@
+#pragma once
+/**
+ * libsk one-shot delay service - many pending microsecond deadlines on a single basic timer
+ *
+ * Pending deadlines are kept in a list sorted by expiry. The timer is run in one-shot mode
+ * and reprogrammed to fire at the earliest deadline only, so there are no periodic
+ * interrupts. Deadlines themselves are kept in DWT cycle counter units, so the time spent
+ * reprogramming and in ISR does not accumulate as error.
+ *
+ * Callbacks are called from timer ISR. Deadlines are limited to 2^31 CPU cycles
+ * (~12.7 s at 168 MHz).
+ *
+ * Resources used: TIM7 (update event).
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+struct sk_oneshot;
+
+
+/**
+ * One-shot callback. Called from timer ISR
+ * @os: expired one-shot
+ * @arg: :c:member:`sk_oneshot.arg` value
+ */
+typedef void (*sk_oneshot_func_t)(struct sk_oneshot *os, void *arg);
+
+
+/** One-shot deadline. :c:member:`sk_oneshot.func` and :c:member:`sk_oneshot.arg` are set by user */
+struct sk_oneshot {
+	/** Callback */
+	sk_oneshot_func_t func;
+	/** Argument passed to callback as is */
+	void *arg;
+	/** Private: next pending one-shot in sorted list */
+	struct sk_oneshot *__next;
+	/** Private: DWT cycle counter value to expire at */
+	uint32_t __deadline;
+	/** Private: set while waiting in list */
+	volatile bool __ispending;
+};
+
+
+/**
+ * Initialize delay service
+ * @irq_priority: timer interrupt priority (as set by :c:func:`nvic_set_priority`)
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_ERANGE` if timer clock does not allow 1 us resolution
+ *
+ * Timer prescaler is computed from :c:data:`rcc_apb1_frequency`, so service must be
+ * initialized again after clock configuration changes
+ */
+sk_err sk_oneshot_init(uint8_t irq_priority);
+
+
+/**
+ * Start (or restart) one-shot
+ * @os: one-shot (:c:type:`sk_oneshot`) with func set
+ * @us: delay in microseconds
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if delay is too long
+ *
+ * May be called from any context including one-shot callbacks
+ */
+sk_err sk_oneshot_start(struct sk_oneshot *os, uint32_t us);
+
+
+/** Cancel pending one-shot. Canceling one-shot which is not pending is allowed */
+void sk_oneshot_cancel(struct sk_oneshot *os);
+
+
+/** Return `true` if one-shot is waiting for expiry */
+inline sk_attr_alwaysinline bool sk_oneshot_is_pending(const struct sk_oneshot *os)
+{
+	return os->__ispending;
+}
+
+
+/**
+ * Sleep for the specified number of microseconds
+ * @us: delay in microseconds
+ *
+ * MCU sleeps with WFI while waiting. Unlike :c:func:`sk_delay_us`, does not burn CPU, and may
+ * be used concurrently with other one-shots
+ */
+void sk_oneshot_delay_us(uint32_t us);
+
+
+/**
+ * Default TIM7 ISR used by delay service.
+ * User may override it, but should call :c:func:`__sk_oneshot_callback` from there.
+ */
+void sk_attr_weak tim7_isr(void);
+
+
+/** Timer update callback. Intended for private use */
+void __sk_oneshot_callback(void);
@@ -4,6 +4,7 @@
  */
 
 #include "config.h"
+#include "errors.h"
 #include "macro.h"
 #include <libopencm3/stm32/gpio.h>
 #include <stdint.h>
@@ -33,6 +34,14 @@ enum sk_port {
 };
 
 
+/** Number of ports available in :c:type:`sk_port` */
+#if SK_USE_SIZE_OPTIMIZATIONS
+#define SK_PORT_COUNT	8
+#else
+#define SK_PORT_COUNT	11
+#endif
+
+
 /**
  * Represents separate GPIO pin
  */
@@ -162,7 +171,8 @@ uint16_t sk_pin_group_read(sk_pin_group group);
  * 0b0A0B0000000000CD.
  *
  * Note:
- * Access to the corresponding GPIO registers is not atomic.
+ * All pins are written with a single store to GPIO BSRR register. So the operation is atomic
+ * and does not interfere with other pins of the same port (i.e. changed from ISR).
  */
 void sk_pin_group_set(sk_pin_group group, uint16_t values);
 
@@ -177,11 +187,381 @@ void sk_pin_group_set(sk_pin_group group, uint16_t values);
  * 0b0A0B0000000000CD.
  *
  * Note:
- * Access to the corresponding GPIO registers is not atomic.
+ * Current output state is read from ODR, and the result is written to BSRR with a single store.
+ * Other pins of the same port are never written, so changing them from ISR is safe.
+ * Concurrently changing pins of this very group still races with toggle.
  */
 void sk_pin_group_toggle(sk_pin_group group, uint16_t values);
 
 
+// Bit-band pin handles
+
+/** Start of Cortex-M4 peripheral bit-band region (see p. 2.2.5 Bit-banding in PM0214) */
+#define SK_BITBAND_PERIPH_BASE	0x40000000ul
+/** Start of peripheral bit-band alias region. Each word there maps to one bit of region */
+#define SK_BITBAND_PERIPH_ALIAS	0x42000000ul
+
+/** Compile-time variant of :c:func:`sk_pin_port_to_gpio`. Intended for private use */
+#define __SK_PORT_TO_GPIO(port) \
+	(GPIO_PORT_A_BASE + (GPIO_PORT_B_BASE - GPIO_PORT_A_BASE) * (port))
+
+/** Address of bit-band alias word for `bit` of a peripheral register at `addr` */
+#define SK_BITBAND_PERIPH_ADDR(addr, bit) \
+	(SK_BITBAND_PERIPH_ALIAS + ((uint32_t)(addr) - SK_BITBAND_PERIPH_BASE) * 32ul + (bit) * 4ul)
+
+
+/**
+ * Represents GPIO pin as a pair of bit-band alias words.
+ * Reading or writing pin becomes a single load or store, with no port base and mask
+ * computations involved.
+ *
+ * Use :c:func:`sk_pin_to_bbpin` to convert from :c:type:`sk_pin` or
+ * :c:macro:`SK_BBPIN_INITIALIZER` for static definitions.
+ */
+struct sk_bbpin {
+	/** Bit-band alias word of pin bit in GPIO IDR */
+	volatile uint32_t *idr;
+	/** Bit-band alias word of pin bit in GPIO ODR */
+	volatile uint32_t *odr;
+	/** Set to true if port input or output should be inverted */
+	bool isinverse;
+};
+
+typedef struct sk_bbpin sk_bbpin;
+
+
+/**
+ * Statically initialize :c:type:`sk_bbpin`
+ * @_port: port as :c:type:`sk_port`
+ * @_pin: pin number (0 .. 15)
+ * @_isinverse: whether pin value should be inverted
+ */
+#define SK_BBPIN_INITIALIZER(_port, _pin, _isinverse) (\
+	(sk_bbpin) {									\
+		.idr = (volatile uint32_t *)SK_BITBAND_PERIPH_ADDR(			\
+			__SK_PORT_TO_GPIO(_port) + 0x10, (_pin)),			\
+		.odr = (volatile uint32_t *)SK_BITBAND_PERIPH_ADDR(			\
+			__SK_PORT_TO_GPIO(_port) + 0x14, (_pin)),			\
+		.isinverse = (_isinverse)						\
+	})
+
+
+/**
+ * Convert :c:type:`sk_pin` to bit-band handle :c:type:`sk_bbpin`
+ * @pin: pin to convert (i.e. one of `sk_io_*` definitions)
+ * @return: bit-band handle for the same pin, with the same inversion
+ *
+ * Conversion is intended to be done once (i.e. at init), with the handle used afterwards
+ */
+inline sk_attr_alwaysinline sk_bbpin sk_pin_to_bbpin(sk_pin pin)
+{
+	uint32_t port = sk_pin_port_to_gpio(pin.port);
+	sk_bbpin ret = {
+		.idr = (volatile uint32_t *)SK_BITBAND_PERIPH_ADDR(&GPIO_IDR(port), pin.pin),
+		.odr = (volatile uint32_t *)SK_BITBAND_PERIPH_ADDR(&GPIO_ODR(port), pin.pin),
+		.isinverse = pin.isinverse
+	};
+	return ret;
+}
+
+
+/**
+ * Read pin input via bit-band alias and return its value
+ * @pin: bit-band pin handle (:c:type:`sk_bbpin`)
+ * @return: boolean value of pin input
+ *
+ * Inversion is taken into account as specified in :c:type:`sk_bbpin`
+ */
+inline sk_attr_alwaysinline bool sk_bbpin_read(sk_bbpin pin)
+{
+	return *pin.idr ^ pin.isinverse;
+}
+
+
+/**
+ * Set pin output level via bit-band alias
+ * @pin: bit-band pin handle (:c:type:`sk_bbpin`)
+ * @value: level to set
+ *
+ * Note:
+ * Bit-band write is performed by bus matrix as an atomic read-modify-write of ODR,
+ * so it does not interfere with other pins of the same port.
+ *
+ * Inversion is taken into account as specified in :c:type:`sk_bbpin`
+ */
+inline sk_attr_alwaysinline void sk_bbpin_set(sk_bbpin pin, bool value)
+{
+	*pin.odr = value ^ pin.isinverse;
+}
+
+
+/**
+ * Toggle pin output level via bit-band alias
+ * @pin: bit-band pin handle (:c:type:`sk_bbpin`)
+ *
+ * Note:
+ * This is a load followed by a store, so it is not atomic with respect to ISRs changing
+ * the same pin. Other pins of the port are not affected.
+ */
+inline sk_attr_alwaysinline void sk_bbpin_toggle(sk_bbpin pin)
+{
+	*pin.odr = !*pin.odr;
+}
+
+
+// Static pins
+
+/**
+ * Define pin known at compile time as a set of dedicated accessors
+ * @name: prefix for generated functions
+ * @_port: port as :c:type:`sk_port`
+ * @_pin: pin number (0 .. 15)
+ * @_isinverse: whether pin value should be inverted
+ *
+ * Generates the following ``static inline`` functions:
+ *  - ``bool name_read(void)`` -- same as :c:func:`sk_pin_read`
+ *  - ``void name_set(bool value)`` -- same as :c:func:`sk_pin_set`
+ *  - ``void name_toggle(void)`` -- same as :c:func:`sk_pin_toggle`
+ *  - ``sk_pin name_pin(void)`` -- returns :c:type:`sk_pin` for use with dynamic API
+ *
+ * Port address, mask and inversion are constants here, so set compiles to a single store to
+ * GPIO BSRR (a constant one if `value` is known at compile time too) with no branches.
+ */
+#define SK_PIN_DEFINE(name, _port, _pin, _isinverse)					\
+static inline sk_attr_alwaysinline sk_pin name##_pin(void)				\
+{											\
+	return (sk_pin){ .port = (_port), .pin = (_pin), .isinverse = (_isinverse) };	\
+}											\
+static inline sk_attr_alwaysinline bool name##_read(void)				\
+{											\
+	return !!(GPIO_IDR(__SK_PORT_TO_GPIO(_port)) & (1ul << (_pin))) ^ (_isinverse);	\
+}											\
+static inline sk_attr_alwaysinline void name##_set(bool value)				\
+{											\
+	/* lower half of BSRR sets pin, higher half resets it */			\
+	GPIO_BSRR(__SK_PORT_TO_GPIO(_port)) =						\
+		1ul << ((_pin) + ((value ^ (_isinverse)) ? 0 : 16));			\
+}											\
+static inline sk_attr_alwaysinline void name##_toggle(void)				\
+{											\
+	uint32_t odr = GPIO_ODR(__SK_PORT_TO_GPIO(_port));				\
+	GPIO_BSRR(__SK_PORT_TO_GPIO(_port)) =						\
+		((odr & (1ul << (_pin))) << 16) | (~odr & (1ul << (_pin)));		\
+}
+
+
+/**
+ * Define group of adjacent pins known at compile time as a set of dedicated accessors
+ * @name: prefix for generated functions
+ * @_port: port as :c:type:`sk_port`
+ * @_lsb: lowest pin number of the group
+ * @_width: number of pins in the group
+ * @_inversions: inversion mask, same as :c:member:`sk_pin_group.inversions`
+ *
+ * Generates the following ``static inline`` functions:
+ *  - ``uint16_t name_read(void)`` -- same as :c:func:`sk_pin_group_read`
+ *  - ``void name_set(uint16_t values)`` -- same as :c:func:`sk_pin_group_set`
+ *  - ``void name_toggle(uint16_t values)`` -- same as :c:func:`sk_pin_group_toggle`
+ *  - ``sk_pin_group name_group(void)`` -- returns :c:type:`sk_pin_group` for dynamic API
+ *
+ * As pins are adjacent, densification and sparsification are simple shifts. So the set
+ * compiles to a few logic instructions and a single BSRR store.
+ */
+#define SK_PIN_GROUP_DEFINE(name, _port, _lsb, _width, _inversions)			\
+static inline sk_attr_alwaysinline sk_pin_group name##_group(void)			\
+{											\
+	return (sk_pin_group){								\
+		.port = (_port),							\
+		.pins = ((1ul << (_width)) - 1) << (_lsb),				\
+		.inversions = (_inversions)						\
+	};										\
+}											\
+static inline sk_attr_alwaysinline uint16_t name##_read(void)				\
+{											\
+	uint32_t val = GPIO_IDR(__SK_PORT_TO_GPIO(_port)) ^ (_inversions);		\
+	return (val >> (_lsb)) & ((1ul << (_width)) - 1);				\
+}											\
+static inline sk_attr_alwaysinline void name##_set(uint16_t values)			\
+{											\
+	const uint32_t mask = ((1ul << (_width)) - 1) << (_lsb);			\
+	uint32_t val = ((uint32_t)values << (_lsb)) ^ (_inversions);			\
+	GPIO_BSRR(__SK_PORT_TO_GPIO(_port)) = (val & mask) | ((~val & mask) << 16);	\
+}											\
+static inline sk_attr_alwaysinline void name##_toggle(uint16_t values)			\
+{											\
+	const uint32_t mask = ((1ul << (_width)) - 1) << (_lsb);			\
+	uint32_t tgl = ((uint32_t)values << (_lsb)) & mask;				\
+	uint32_t odr = GPIO_ODR(__SK_PORT_TO_GPIO(_port));				\
+	GPIO_BSRR(__SK_PORT_TO_GPIO(_port)) = (tgl & ~odr) | ((tgl & odr) << 16);	\
+}
+
+
+// Declarative pin configuration
+
+/**
+ * Configuration of a set of pins residing in the same GPIO port.
+ * An array of these forms a pin configuration table, applied with :c:func:`sk_pin_cfg_apply`.
+ *
+ * Field values are the same as used by libopencm3 :c:func:`gpio_mode_setup`,
+ * :c:func:`gpio_set_output_options` and :c:func:`gpio_set_af`
+ */
+struct sk_pin_cfg {
+	/** Port value as :c:type:`sk_port` */
+	uint8_t port;
+	/** 16-bit mask where each bit represents corresponding pin in a port */
+	uint16_t pins;
+	/** 16-bit mask of pins with inverted output. Only used for :c:member:`sk_pin_cfg.outval` */
+	uint16_t inversions;
+	/** Pin mode (GPIO_MODE_INPUT, GPIO_MODE_OUTPUT, GPIO_MODE_AF, GPIO_MODE_ANALOG) */
+	uint8_t mode   : 2;
+	/** Pull-up/pull-down (GPIO_PUPD_NONE, GPIO_PUPD_PULLUP, GPIO_PUPD_PULLDOWN) */
+	uint8_t pupd   : 2;
+	/** Output type (GPIO_OTYPE_PP, GPIO_OTYPE_OD) */
+	uint8_t otype  : 1;
+	/** Output speed (GPIO_OSPEED_2MHZ .. GPIO_OSPEED_100MHZ) */
+	uint8_t ospeed : 2;
+	/** Initial output level, inversion is taken into account */
+	uint8_t outval : 1;
+	/** Alternate function number (GPIO_AF0 .. GPIO_AF15) */
+	uint8_t af     : 4;
+};
+
+
+/**
+ * Helper to fill :c:type:`sk_pin_cfg` port, pins and inversions from a single :c:type:`sk_pin`.
+ * Use inside designated initializer, i.e.
+ * ``{ SK_PIN_CFG_PIN(sk_io_led_red), .mode = GPIO_MODE_OUTPUT }``
+ */
+#define SK_PIN_CFG_PIN(_pin)	\
+	.port = (_pin).port, .pins = (1 << (_pin).pin), .inversions = ((_pin).isinverse << (_pin).pin)
+
+
+/**
+ * Helper to fill :c:type:`sk_pin_cfg` port, pins and inversions from :c:type:`sk_pin_group`.
+ */
+#define SK_PIN_CFG_GROUP(_group)	\
+	.port = (_group).port, .pins = (_group).pins, .inversions = (_group).inversions
+
+
+/**
+ * Apply pin configuration table
+ * @cfg: array of :c:type:`sk_pin_cfg` entries
+ * @len: number of entries in `cfg`
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong port in any entry
+ *
+ * Entries are folded per port, so each of MODER, OTYPER, OSPEEDR, PUPDR, AFRL, AFRH is written
+ * once per used port, and clocks for all used ports are enabled with a single RCC write.
+ * When entries overlap, the later one wins.
+ *
+ * Initial output levels are set before switching mode, so outputs start glitch-free.
+ * Nothing is written if any entry is wrong.
+ */
+sk_err sk_pin_cfg_apply(const struct sk_pin_cfg *cfg, uint32_t len);
+
+
+// Multi-port transactions
+
+/**
+ * Pin transaction. Collects pin changes spanning several ports and applies them at once
+ * with :c:func:`sk_pin_txn_commit`, which does exactly one BSRR store per used port.
+ * Compared to separate :c:func:`sk_pin_set` / :c:func:`sk_pin_group_set` calls, this
+ * reduces bus accesses and the skew between edges of pins on different ports.
+ *
+ * Transaction is a plain object in memory, so it may be prepared in advance (i.e. outside
+ * of time-critical section) and committed many times.
+ */
+struct sk_pin_txn {
+	/** Private: accumulated BSRR word for each port. Only valid for ports in __ports */
+	uint32_t __bsrr[SK_PORT_COUNT];
+	/** Private: mask of ports with pending changes, each bit represents :c:type:`sk_port` */
+	uint16_t __ports;
+};
+
+
+/**
+ * Snapshot of several ports' inputs taken in a row with :c:func:`sk_pin_snapshot_take`.
+ * Values are then extracted with :c:func:`sk_pin_snapshot_read` and
+ * :c:func:`sk_pin_snapshot_group_read` without touching GPIO again
+ */
+struct sk_pin_snapshot {
+	/** Private: IDR value for each port. Only ports requested in take are valid */
+	uint16_t __idr[SK_PORT_COUNT];
+};
+
+
+typedef struct sk_pin_txn sk_pin_txn;
+typedef struct sk_pin_snapshot sk_pin_snapshot;
+
+
+/** Empty transaction initializer. Use as ``sk_pin_txn txn = SK_PIN_TXN_INITIALIZER;`` */
+#define SK_PIN_TXN_INITIALIZER	((sk_pin_txn){ .__ports = 0 })
+
+
+/** Discard all changes collected in transaction */
+inline sk_attr_alwaysinline void sk_pin_txn_clear(sk_pin_txn *txn)
+{
+	txn->__ports = 0;	// BSRR words of unused ports are ignored, no need to zero them
+}
+
+
+/**
+ * Add pin change to transaction
+ * @txn: transaction (:c:type:`sk_pin_txn`)
+ * @pin: pin to set
+ * @value: value to set pin to. Inversion is taken into account as in :c:func:`sk_pin_set`
+ *
+ * When the same pin is changed several times within transaction, the last change wins
+ */
+void sk_pin_txn_set(sk_pin_txn *txn, sk_pin pin, bool value);
+
+
+/**
+ * Add group change to transaction
+ * @txn: transaction (:c:type:`sk_pin_txn`)
+ * @group: pin group (:c:type:`sk_pin_group`)
+ * @values: densified value, same as for :c:func:`sk_pin_group_set`
+ *
+ * When the same pin is changed several times within transaction, the last change wins
+ */
+void sk_pin_txn_group_set(sk_pin_txn *txn, sk_pin_group group, uint16_t values);
+
+
+/**
+ * Apply transaction
+ * @txn: transaction (:c:type:`sk_pin_txn`)
+ *
+ * Writes BSRR once per port with pending changes. Ports are always written in ascending
+ * order (port A first), so if the order of edges matters (i.e. data before strobe), place
+ * the changes into separate transactions.
+ * Transaction is left intact and may be committed again.
+ */
+void sk_pin_txn_commit(const sk_pin_txn *txn);
+
+
+/**
+ * Read inputs of several ports back-to-back
+ * @snap: snapshot (:c:type:`sk_pin_snapshot`) to store values in
+ * @ports: mask of ports to read, each bit represents :c:type:`sk_port`,
+ *         i.e. ``(1 << SK_PORTA) | (1 << SK_PORTC)``
+ *
+ * Ports are read in ascending order with no processing in between
+ */
+void sk_pin_snapshot_take(sk_pin_snapshot *snap, uint16_t ports);
+
+
+/**
+ * Read pin from snapshot. Same as :c:func:`sk_pin_read`, but port must be captured in `snap`
+ */
+bool sk_pin_snapshot_read(const sk_pin_snapshot *snap, sk_pin pin);
+
+
+/**
+ * Read group from snapshot. Same as :c:func:`sk_pin_group_read`, but port must be captured
+ * in `snap`
+ */
+uint16_t sk_pin_snapshot_group_read(const sk_pin_snapshot *snap, sk_pin_group group);
+
+
 #if SK_USE_GLSK_DEFINITIONS
 
 // some STM32F4DISCOVERY pins
@@ -205,6 +585,13 @@ extern const sk_pin sk_io_spiflash_ce;
 
 extern const sk_pin_group sk_io_lcd_data;
 
+// Static (compile-time) variants of GL-SK LCD pins used in bit-bang.
+// Must be kept in sync with their sk_io_lcd_* counterparts in pin.c
+SK_PIN_DEFINE(sk_sio_lcd_rs, SK_PORTE, 7, false)
+SK_PIN_DEFINE(sk_sio_lcd_rw, SK_PORTE, 10, false)
+SK_PIN_DEFINE(sk_sio_lcd_en, SK_PORTE, 11, false)
+SK_PIN_GROUP_DEFINE(sk_sio_lcd_data, SK_PORTE, 12, 4, 0)
+
 #if !(SK_USE_SIZE_OPTIMIZATIONS)
 /**
  * Initialize pins available on GL-SK board
@@ -0,0 +1,135 @@
+#pragma once
+/**
+ * libsk periodic tasks - rate-monotonic runner of periodic work with timing statistics
+ *
+ * Each task is released every :c:member:`sk_ptask.period` ticks. Among released tasks the one
+ * with the shortest period runs first (rate-monotonic priorities). Tasks run to completion
+ * and are not preempted by each other.
+ *
+ * For every task the runner measures:
+ *
+ *  - release jitter: delay from the tick boundary task was released at to the moment it
+ *    started, in CPU cycles
+ *  - execution time: min, max and average in CPU cycles (DWT cycle counter)
+ *  - deadline overruns: runs completed later than :c:member:`sk_ptask.deadline` after release
+ *  - skipped releases: periods dropped entirely because task was too late
+ *
+ * Cycles are converted to time by dividing by :c:data:`rcc_ahb_frequency`.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** Maximum number of tasks in runner */
+#define SK_PTASK_MAXTASKS	16
+
+
+struct sk_ptask;
+
+
+/**
+ * Task function
+ * @task: task being run
+ * @arg: :c:member:`sk_ptask.arg` value
+ */
+typedef void (*sk_ptask_func_t)(struct sk_ptask *task, void *arg);
+
+
+/** Task timing statistics */
+struct sk_ptask_stats {
+	/** Number of runs */
+	uint32_t nruns;
+	/** Number of runs completed after deadline */
+	uint32_t noverruns;
+	/** Number of releases skipped, because task was late for more than a period */
+	uint32_t nskipped;
+	/** Minimal release jitter in CPU cycles */
+	uint32_t jitter_min;
+	/** Maximal release jitter in CPU cycles */
+	uint32_t jitter_max;
+	/** Minimal execution time in CPU cycles */
+	uint32_t exec_min;
+	/** Maximal execution time in CPU cycles */
+	uint32_t exec_max;
+	/** Total execution time in CPU cycles. Average is `exec_total / nruns` */
+	uint64_t exec_total;
+};
+
+
+/**
+ * Periodic task. Fields up to :c:member:`sk_ptask.phase` are to be set by user
+ */
+struct sk_ptask {
+	/** Task function */
+	sk_ptask_func_t func;
+	/** User data passed to task function as is */
+	void *arg;
+	/** Period in ticks */
+	uint32_t period;
+	/** Deadline in ticks relative to release. 0 means deadline equals period */
+	uint32_t deadline;
+	/** Offset of the first release in ticks. Allows spreading tasks with the same period */
+	uint32_t phase;
+	/** Timing statistics. Use :c:func:`sk_ptask_get_stats` to read */
+	struct sk_ptask_stats stats;
+	/** Private: tick value of the next release */
+	uint64_t __release;
+};
+
+
+/** Periodic task runner */
+struct sk_ptask_runner {
+	/** Array of tasks */
+	struct sk_ptask *tasks;
+	/** Number of tasks */
+	uint8_t ntasks;
+	/** Private: task indexes sorted by priority (shortest period first) */
+	uint8_t __order[SK_PTASK_MAXTASKS];
+};
+
+
+/**
+ * Initialize runner and schedule the first release of all tasks
+ * @runner: runner (:c:type:`sk_ptask_runner`)
+ * @tasks: array of tasks with func, arg, period, deadline and phase set
+ * @ntasks: number of tasks (1 .. :c:macro:`SK_PTASK_MAXTASKS`)
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments
+ *
+ * Tick must be already initialized with :c:func:`sk_tick_init`. First release of each task
+ * happens at the next tick boundary plus task phase. Statistics are reset.
+ */
+sk_err sk_ptask_runner_init(struct sk_ptask_runner *runner, struct sk_ptask *tasks,
+							uint8_t ntasks);
+
+
+/**
+ * Run the highest priority released task if any. Never sleeps
+ * @runner: runner (:c:type:`sk_ptask_runner`)
+ * @return: `true` if a task was run
+ */
+bool sk_ptask_run_once(struct sk_ptask_runner *runner);
+
+
+/**
+ * Run tasks forever, sleeping between releases
+ * @runner: runner (:c:type:`sk_ptask_runner`)
+ *
+ * Uses :c:func:`sk_tick_idle`, so MCU is not woken up by ticks while waiting for the next
+ * release
+ */
+void sk_ptask_run(struct sk_ptask_runner *runner);
+
+
+/**
+ * Get task statistics
+ * @task: task (:c:type:`sk_ptask`)
+ * @stats: where to store statistics
+ */
+void sk_ptask_get_stats(const struct sk_ptask *task, struct sk_ptask_stats *stats);
+
+
+/** Reset task statistics */
+void sk_ptask_reset_stats(struct sk_ptask *task);
@@ -0,0 +1,93 @@
+#pragma once
+/**
+ * libsk hardware PWM - timer output compare channels driven from :c:type:`sk_pin`
+ *
+ * Timer channel and alternate function are looked up by pin, and timer prescaler and period
+ * are solved from timer clock. Duty is written to preloaded compare register, so it takes effect
+ * at the start of the next PWM period and no glitches occur.
+ *
+ * Duty sequences (fades, flicker effects) are output by DMA on timer update event, one value
+ * per PWM period, without CPU involvement. Sequences are available on TIM1, TIM3, TIM4, TIM8.
+ * Note that :c:func:`sk_lacap_init` uses TIM1 and DMA2 Stream 5, :c:func:`sk_wave_init` uses
+ * TIM8 and DMA2 Stream 1.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include "pin.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** PWM channel object */
+struct sk_pwm {
+	/** Timer base address as in libopencm3 */
+	uint32_t tim;
+	/** Timer channel (1 .. 4) */
+	uint8_t channel;
+	/** Number of duty steps in period. Duty values range from 0 to resolution */
+	uint32_t resolution;
+	/** Actual PWM frequency, which may differ from requested due to timer resolution */
+	uint32_t freq_hz;
+	/** Private: index into timer descriptor table */
+	uint8_t __timidx;
+};
+
+
+/**
+ * Initialize PWM channel and start its output with zero duty
+ * @pwm: PWM object (:c:type:`sk_pwm`)
+ * @pin: output pin. Inversion is taken into account, so duty is the active (non-inverted) time
+ * @tim: timer base address as in libopencm3, or 0 to pick the first timer available on pin
+ * @freq_hz: desired PWM frequency
+ * @resolution: number of duty steps in period, or 0 for the finest one reachable
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_EUNAVAILABLE` if pin has no such timer output, or if timer is
+ *          already running with a different frequency or resolution,
+ *          :c:macro:`SK_ERANGE` if frequency and resolution can not be reached
+ *
+ * Several channels of the same timer share its frequency and resolution. The first channel
+ * initialized sets them up, the others must request the same values.
+ * Pin is switched to alternate function.
+ */
+sk_err sk_pwm_init(struct sk_pwm *pwm, sk_pin pin, uint32_t tim, uint32_t freq_hz,
+				   uint32_t resolution);
+
+
+/**
+ * Set duty
+ * @pwm: PWM object (:c:type:`sk_pwm`)
+ * @duty: active time in steps (0 .. :c:member:`sk_pwm.resolution`). Larger values are clamped
+ *
+ * New value takes effect at the start of the next PWM period
+ */
+void sk_pwm_set_duty(const struct sk_pwm *pwm, uint32_t duty);
+
+
+/**
+ * Start DMA-driven duty sequence
+ * @pwm: PWM object (:c:type:`sk_pwm`)
+ * @seq: array of duty values. Must stay valid while sequence is running
+ * @len: number of values in sequence
+ * @repeat: number of PWM periods each value is held for (1 .. 256). Values above 1 are only
+ *          available on TIM1 and TIM8, which have repetition counter
+ * @isloop: restart sequence from beginning endlessly. Otherwise the last value is kept
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_EUNAVAILABLE` if timer has no update DMA request or repetition
+ *          counter, or if a sequence is already running on the same timer
+ *
+ * Repetition counter delays preloaded compare values of the other timer channels as well,
+ * so their duty changes take effect only once per `repeat` periods while sequence is running.
+ */
+sk_err sk_pwm_seq_start(struct sk_pwm *pwm, const uint16_t *seq, uint16_t len, uint16_t repeat,
+						bool isloop);
+
+
+/** Stop duty sequence. Output keeps the last duty value written */
+void sk_pwm_seq_stop(struct sk_pwm *pwm);
+
+
+/** Return `true` while duty sequence is running */
+bool sk_pwm_seq_is_running(const struct sk_pwm *pwm);
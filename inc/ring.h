@@ -0,0 +1,197 @@
+#pragma once
+/**
+ * libsk lock-free single-producer single-consumer byte ring
+ *
+ * Capacity is a power of two, so indices are wrapped with a mask instead of division.
+ * Indices are free-running 32-bit counters: the number of stored bytes is simply their
+ * difference, and full and empty states need no extra flag.
+ * Each index is written only by its own side (head by producer, tail by consumer), so one
+ * producer and one consumer (i.e. ISR and main loop) need no locking.
+ *
+ * Supersedes :c:type:`sk_bfifo_t`, which divides on every byte and shares its full flag
+ * between both sides.
+ */
+
+#include "errors.h"
+#include "intrinsics.h"
+#include "macro.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/** SPSC ring object */
+struct sk_ring {
+	/** Storage buffer */
+	uint8_t *buf;
+	/** Private: capacity minus one. Capacity is a power of two */
+	uint32_t __mask;
+	/** Private: number of bytes ever put. Written by producer only */
+	volatile uint32_t __head;
+	/** Private: number of bytes ever taken. Written by consumer only */
+	volatile uint32_t __tail;
+};
+
+typedef struct sk_ring sk_ring;
+
+
+/** Ring initializer. `_buflen` must be a power of two */
+#define SK_RING_INITIALIZER(_buf, _buflen)	\
+	((sk_ring){ .buf = (_buf), .__mask = (_buflen) - 1, .__head = 0, .__tail = 0 })
+
+
+/**
+ * Statically declare and initialize ring
+ * @name: name under which :c:type:`sk_ring` object will be available
+ * @buf: storage buffer
+ * @buflen: length of `buf`. Must be a power of two
+ */
+#define SK_RING_DECLARE(name, buf, buflen) sk_ring name = SK_RING_INITIALIZER(buf, buflen)
+
+
+/**
+ * Dynamically initialize ring
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @buf: storage buffer
+ * @buflen: length of `buf`. Must be a power of two (1 .. 2^30)
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments
+ */
+sk_err sk_ring_init(sk_ring *ring, uint8_t *buf, uint32_t buflen);
+
+
+/** Return ring capacity in bytes */
+inline sk_attr_alwaysinline uint32_t sk_ring_get_size(const sk_ring *ring)
+{
+	return ring->__mask + 1;
+}
+
+
+/** Return number of bytes stored in ring */
+inline sk_attr_alwaysinline uint32_t sk_ring_get_used(const sk_ring *ring)
+{
+	return ring->__head - ring->__tail;		// stays valid across index overflow
+}
+
+
+/** Return number of bytes which may be put into ring */
+inline sk_attr_alwaysinline uint32_t sk_ring_get_free(const sk_ring *ring)
+{
+	return sk_ring_get_size(ring) - sk_ring_get_used(ring);
+}
+
+
+/**
+ * Put single byte into ring. Producer side
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @byte: value to put
+ * @return: `true` on success, `false` if ring is full
+ */
+inline sk_attr_alwaysinline bool sk_ring_put_byte(sk_ring *ring, uint8_t byte)
+{
+	uint32_t head = ring->__head;
+	if (head - ring->__tail > ring->__mask)
+		return false;
+	__DMB();	// slot is read by consumer before it advanced tail. Do not overwrite it earlier
+	ring->buf[head & ring->__mask] = byte;
+	__DMB();	// data must be in memory before consumer can see new head
+	ring->__head = head + 1;
+	return true;
+}
+
+
+/**
+ * Get single byte from ring. Consumer side
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @byte: pointer where to store value
+ * @return: `true` on success, `false` if ring is empty
+ */
+inline sk_attr_alwaysinline bool sk_ring_get_byte(sk_ring *ring, uint8_t *byte)
+{
+	uint32_t tail = ring->__tail;
+	if (ring->__head == tail)
+		return false;
+	__DMB();	// data written by producer before head must be read after head
+	*byte = ring->buf[tail & ring->__mask];
+	__DMB();	// finish reading slot before producer is allowed to reuse it
+	ring->__tail = tail + 1;
+	return true;
+}
+
+
+/**
+ * Put bytes into ring. Producer side
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @data: bytes to put
+ * @len: number of bytes
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if `len` exceeds ring capacity,
+ *          :c:macro:`SK_EFULL` if there is not enough free space
+ *
+ * Like :c:func:`sk_bfifo_put`, this is all-or-nothing: no partial writes are done.
+ * Data is copied in at most two contiguous chunks
+ */
+sk_err sk_ring_put(sk_ring *ring, const void *data, uint32_t len);
+
+
+/**
+ * Get up to `len` bytes from ring. Consumer side
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @data: buffer where to store bytes
+ * @len: maximum number of bytes to get
+ * @return: number of bytes actually read,
+ *          :c:macro:`SK_EEMPTY` if ring is empty and `len` is not 0,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments
+ *
+ * Data is copied in at most two contiguous chunks
+ */
+int32_t sk_ring_get(sk_ring *ring, void *data, uint32_t len);
+
+
+// Zero-copy access. Instead of copying through a temporary array, producer (or DMA, driver)
+// fills ring storage in place and then commits, consumer drains it in place and then consumes
+
+/**
+ * Return the largest contiguous free region. Producer side
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @span: pointer where to store region start
+ * @return: region length in bytes. 0 if ring is full or on wrong arguments
+ *
+ * Free space wrapping over the end of buffer is returned in two steps, so region may be
+ * shorter than :c:func:`sk_ring_get_free`. Region becomes visible to consumer only after
+ * :c:func:`sk_ring_commit`
+ */
+uint32_t sk_ring_reserve(sk_ring *ring, uint8_t **span);
+
+
+/**
+ * Make bytes written into reserved region available to consumer. Producer side
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @len: number of bytes written from the start of region returned by :c:func:`sk_ring_reserve`
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if `len` exceeds the region
+ */
+sk_err sk_ring_commit(sk_ring *ring, uint32_t len);
+
+
+/**
+ * Return the largest contiguous region of stored bytes. Consumer side
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @span: pointer where to store region start
+ * @return: region length in bytes. 0 if ring is empty or on wrong arguments
+ *
+ * Stored bytes wrapping over the end of buffer are returned in two steps. Region stays
+ * valid until released with :c:func:`sk_ring_consume`
+ */
+uint32_t sk_ring_peek(sk_ring *ring, const uint8_t **span);
+
+
+/**
+ * Release bytes read from peeked region, so that producer may reuse them. Consumer side
+ * @ring: ring object (:c:type:`sk_ring`)
+ * @len: number of bytes released from the start of region returned by :c:func:`sk_ring_peek`
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if `len` exceeds the region
+ */
+sk_err sk_ring_consume(sk_ring *ring, uint32_t len);
@@ -0,0 +1,195 @@
+#pragma once
+/**
+ * libsk software timers - callbacks scheduled on system ticks using hierarchical timing wheel
+ *
+ * Timers are kept in 4 wheels of 64 slots each. Wheel 0 holds timers expiring within the next
+ * 64 ticks, one slot per tick. Wheel N holds timers expiring later, one slot per 64^N ticks,
+ * and its slot is moved (cascaded) into the lower wheels when time comes. So start and cancel
+ * are O(1), and each tick only touches the timers which expire on it, regardless of the
+ * total number of timers.
+ * Timers due in more than 2^24 ticks are parked in the last wheel and re-inserted as needed.
+ *
+ * Wheel is advanced from tick ISR, i.e. from overridden sys_tick_handler:
+ *
+ * .. code-block:: c
+ *
+ *    void sys_tick_handler(void)
+ *    {
+ *        __sk_tick_inc_callback();
+ *        sk_swtimer_wheel_tick(&wheel);
+ *    }
+ *
+ * Timer callbacks run either right in tick ISR or are deferred to the main loop, where they
+ * are run by :c:func:`sk_swtimer_run_deferred`.
+ *
+ * Timer functions may be called from main loop, from timer callbacks and from ISRs with
+ * priority not higher than SysTick. They mask interrupts for a few instructions internally.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/** Number of wheels. Intended for private use */
+#define __SK_SWTIMER_LEVELS		4
+/** log2 of number of slots in each wheel. Intended for private use */
+#define __SK_SWTIMER_SLOTBITS	6
+/** Number of slots in each wheel. Intended for private use */
+#define __SK_SWTIMER_SLOTS		(1 << __SK_SWTIMER_SLOTBITS)
+
+/**
+ * Maximum timer delay and period in ticks (~24.8 days at 1 kHz tick).
+ * Expiries are compared as signed differences of tick values, so longer ones would look overdue
+ */
+#define SK_SWTIMER_MAX_TICKS	0x7FFFFFFFul
+
+
+struct sk_swtimer;
+
+
+/**
+ * Timer callback
+ * @timer: expired timer
+ * @arg: argument given to :c:func:`sk_swtimer_init`
+ */
+typedef void (*sk_swtimer_func_t)(struct sk_swtimer *timer, void *arg);
+
+
+/** Software timer. Initialize with :c:func:`sk_swtimer_init` */
+struct sk_swtimer {
+	/** Callback called on expiry */
+	sk_swtimer_func_t func;
+	/** Argument passed to callback as is */
+	void *arg;
+	/** Period in ticks for periodic timer, 0 for one-shot. Up to :c:macro:`SK_SWTIMER_MAX_TICKS` */
+	uint32_t period;
+	/** Run callback in main loop (`true`) or right in tick ISR (`false`) */
+	bool isdeferred;
+	/**
+	 * Number of expiries of deferred timer which were merged with the previous one, because
+	 * its callback was not run in time
+	 */
+	uint32_t noverruns;
+	// private (mangled) members
+	/** Private: next timer in wheel slot */
+	struct sk_swtimer *__next;
+	/** Private: pointer to pointer to this timer in wheel slot, NULL when not in wheel */
+	struct sk_swtimer **__pprev;
+	/** Private: next timer in deferred list */
+	struct sk_swtimer *__rnext;
+	/** Private: pointer to pointer to this timer in deferred list, NULL when not in list */
+	struct sk_swtimer **__rpprev;
+	/** Private: tick value at which timer expires */
+	uint32_t __expires;
+	/** Private: wheel and slot number timer resides in */
+	uint16_t __slot;
+};
+
+
+/** Timing wheel holding timers. Initialize with :c:func:`sk_swtimer_wheel_init` */
+struct sk_swtimer_wheel {
+	/** Private: tick value wheel was last advanced to */
+	uint32_t __now;
+	/** Private: bitmaps of non-empty slots, one per wheel */
+	uint64_t __occupied[__SK_SWTIMER_LEVELS];
+	/** Private: slot lists */
+	struct sk_swtimer *__slots[__SK_SWTIMER_LEVELS][__SK_SWTIMER_SLOTS];
+	/** Private: expired deferred timers waiting to be run */
+	struct sk_swtimer *__ready;
+	/** Private: tail of deferred list */
+	struct sk_swtimer **__readytail;
+};
+
+
+/**
+ * Initialize timing wheel
+ * @wheel: timing wheel (:c:type:`sk_swtimer_wheel`)
+ *
+ * Wheel starts at the current tick value (:c:func:`sk_tick_get_current`)
+ */
+void sk_swtimer_wheel_init(struct sk_swtimer_wheel *wheel);
+
+
+/**
+ * Initialize timer
+ * @timer: timer (:c:type:`sk_swtimer`)
+ * @func: callback
+ * @arg: argument passed to callback as is
+ * @isdeferred: run callback from :c:func:`sk_swtimer_run_deferred` instead of tick ISR
+ */
+void sk_swtimer_init(struct sk_swtimer *timer, sk_swtimer_func_t func, void *arg,
+					 bool isdeferred);
+
+
+/**
+ * Start (or restart) timer
+ * @wheel: timing wheel (:c:type:`sk_swtimer_wheel`)
+ * @timer: timer (:c:type:`sk_swtimer`)
+ * @delay: number of ticks till the first expiry (1 .. :c:macro:`SK_SWTIMER_MAX_TICKS`)
+ * @period: period in ticks for periodic timer (up to :c:macro:`SK_SWTIMER_MAX_TICKS`),
+ *          0 for one-shot
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if `delay` or `period` exceeds :c:macro:`SK_SWTIMER_MAX_TICKS`
+ *
+ * Periodic timers are re-armed relative to their previous expiry, so they do not drift
+ * regardless of callback run time.
+ */
+sk_err sk_swtimer_start(struct sk_swtimer_wheel *wheel, struct sk_swtimer *timer,
+						uint32_t delay, uint32_t period);
+
+
+/**
+ * Stop timer
+ * @wheel: timing wheel (:c:type:`sk_swtimer_wheel`)
+ * @timer: timer (:c:type:`sk_swtimer`)
+ *
+ * Also drops pending deferred callback. Stopping inactive timer is allowed
+ */
+void sk_swtimer_cancel(struct sk_swtimer_wheel *wheel, struct sk_swtimer *timer);
+
+
+/** Return `true` if timer is waiting for expiry */
+inline sk_attr_alwaysinline bool sk_swtimer_is_active(const struct sk_swtimer *timer)
+{
+	return (NULL != timer->__pprev);
+}
+
+
+/**
+ * Advance timing wheel to the current tick value. Must be called from tick ISR
+ * @wheel: timing wheel (:c:type:`sk_swtimer_wheel`)
+ *
+ * Catches up when ticks were skipped (i.e. after :c:func:`sk_tick_idle`), expiring timers
+ * in order.
+ */
+void sk_swtimer_wheel_tick(struct sk_swtimer_wheel *wheel);
+
+
+/**
+ * Run callbacks of expired deferred timers
+ * @wheel: timing wheel (:c:type:`sk_swtimer_wheel`)
+ * @return: number of callbacks run
+ *
+ * Intended to be called from main loop
+ */
+uint32_t sk_swtimer_run_deferred(struct sk_swtimer_wheel *wheel);
+
+
+/** Return `true` if there are expired deferred timers for :c:func:`sk_swtimer_run_deferred` */
+inline sk_attr_alwaysinline bool sk_swtimer_has_deferred(const struct sk_swtimer_wheel *wheel)
+{
+	return (NULL != wheel->__ready);
+}
+
+
+/**
+ * Return number of ticks wheel does not need to be advanced for
+ * @wheel: timing wheel (:c:type:`sk_swtimer_wheel`)
+ * @return: ticks till the nearest expiry or cascade, `UINT32_MAX` when there are no timers
+ *
+ * Intended for tickless idle, i.e. as an argument to :c:func:`sk_tick_idle`
+ */
+uint32_t sk_swtimer_get_idle_ticks(struct sk_swtimer_wheel *wheel);
@@ -1,7 +1,9 @@
+#pragma once
 /**
  * libsk syncronization primitives
  */
 
+#include "config.h"
 #include "errors.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -23,12 +25,32 @@ typedef uint8_t sk_lock_t;
 #define SK_LOCK_DECLARE(name) sk_lock_t name = __SK_LOCK_UNLOCKED
 
 
+/**
+ * Lock contention counters.
+ * Updated by the context which has just acquired the lock, so no extra atomics are needed
+ */
+struct sk_lock_stats {
+	/** Number of times lock was acquired */
+	uint32_t nacquires;
+	/** Number of acquisitions which had to wait for lock */
+	uint32_t ncontended;
+	/** Number of WFE wakeups while waiting. Wakeups without lock release mean spurious events */
+	uint32_t nwakeups;
+	/** Total CPU cycles spent waiting. Counted only if DWT cycle counter is enabled */
+	uint64_t waitcycles;
+	/** The longest single wait in CPU cycles */
+	uint32_t maxwaitcycles;
+};
+
+
 /**
  * Unlock a lock
  * @lock: pointer to :c:type:`sk_lock_t` object
  *
  * Note: Unlock does not control who captured the lock and whether is was captured at all,
  *       it simply unlocks
+ *
+ * Issues SEV, so that contexts waiting in :c:func:`sk_lock_spinlock` wake up
  */
 void sk_lock_unlock(sk_lock_t *lock);
 
@@ -49,12 +71,77 @@ bool sk_lock_trylock(sk_lock_t *lock);
  *
  * This call IS blocking. It will return only after the lock was captured.
  * Thus deadlocks have more chances to occur
+ *
+ * Core sleeps with WFE between attempts instead of spinning at full power. It is woken up
+ * by SEV from :c:func:`sk_lock_unlock` or by any interrupt (i.e. scheduler tick switching
+ * to the lock holder)
  */
 void sk_lock_spinlock(sk_lock_t *lock);
 
 
+/**
+ * Same as :c:func:`sk_lock_spinlock`, but also update contention counters
+ * @lock: pointer to :c:type:`sk_lock_t` object
+ * @stats: counters (:c:type:`sk_lock_stats`) kept by user for this lock
+ */
+void sk_lock_spinlock_stats(sk_lock_t *lock, struct sk_lock_stats *stats);
+
+
+/**
+ * FIFO-fair ticket lock.
+ * Each waiter takes the next ticket and waits (sleeping with WFE) until its number is served,
+ * so lock is granted in order of arrival and no waiter starves.
+ *
+ * As with :c:type:`sk_lock_t`, lock must not be waited on from context which preempts the
+ * holder (i.e. ISR waiting for lock held by main loop), as holder never gets to run
+ */
+struct sk_ticketlock {
+	/** Private: next ticket to hand out */
+	volatile uint32_t __next;
+	/** Private: ticket being served */
+	volatile uint32_t __owner;
+#if SK_USE_LOCK_STATS
+	/** Contention counters. Read them while holding the lock to get consistent values */
+	struct sk_lock_stats stats;
+#endif
+};
+
+typedef struct sk_ticketlock sk_ticketlock;
+
+
+/** Unlocked ticket lock initializer */
+#define SK_TICKETLOCK_INITIALIZER ((sk_ticketlock){ .__next = 0, .__owner = 0 })
+
+
+/**
+ * Acquire ticket lock (blocking)
+ * @lock: pointer to :c:type:`sk_ticketlock` object
+ */
+void sk_ticketlock_lock(sk_ticketlock *lock);
+
+
+/**
+ * Try to acquire ticket lock (non-blocking)
+ * @lock: pointer to :c:type:`sk_ticketlock` object
+ * @return: `true` if lock was acquired, `false` if it is held or has waiters
+ */
+bool sk_ticketlock_trylock(sk_ticketlock *lock);
+
+
+/**
+ * Release ticket lock and wake waiters up
+ * @lock: pointer to :c:type:`sk_ticketlock` object
+ *
+ * Must only be called by the holder
+ */
+void sk_ticketlock_unlock(sk_ticketlock *lock);
+
+
 // BFIFO-related
 
+// New code should use :c:type:`sk_ring` from ring.h, which avoids division per byte and
+// is safe for one producer and one consumer without locking
+
 typedef uint16_t sk_bfifo_len_t;
 
 struct sk_bfifo {
@@ -99,3 +186,63 @@ sk_err sk_bfifo_init(sk_bfifo_t *fifo, uint8_t *buf, sk_bfifo_len_t buflen);
 sk_err sk_bfifo_put(sk_bfifo_t *fifo, uint8_t *barr, uint32_t len);
 
 int32_t sk_bfifo_get(sk_bfifo_t *fifo, uint8_t *barr, uint32_t len);
+
+
+/** Return number of bytes stored in bfifo */
+sk_bfifo_len_t sk_bfifo_get_used(sk_bfifo_t *fifo);
+
+
+/** Return number of bytes which may be put into bfifo */
+sk_bfifo_len_t sk_bfifo_get_free(sk_bfifo_t *fifo);
+
+
+
+// Zero-copy access to bfifo.
+// Both sides update shared isfull flag, so these are NOT safe for lock-free single-producer
+// single-consumer use: i.e. producer ISR filling the region just freed by consume sets isfull,
+// and consumer clearing it afterwards makes full bfifo look empty. Calls from different contexts
+// need external locking (i.e. with interrupts masked). For ISR/DMA-fed streams use
+// :c:func:`sk_ring_reserve` and friends instead, which have no shared flag
+
+/**
+ * Return the largest contiguous free region of bfifo, to be filled in place
+ * @fifo: bfifo object
+ * @span: pointer where to store region start
+ * @return: region length in bytes. 0 if bfifo is full or on wrong arguments
+ *
+ * Filled bytes are added to bfifo with :c:func:`sk_bfifo_commit`
+ */
+sk_bfifo_len_t sk_bfifo_reserve(sk_bfifo_t *fifo, uint8_t **span);
+
+
+/**
+ * Add bytes written into region returned by :c:func:`sk_bfifo_reserve`
+ * @fifo: bfifo object
+ * @len: number of bytes written from region start
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if `len` exceeds the region
+ */
+sk_err sk_bfifo_commit(sk_bfifo_t *fifo, sk_bfifo_len_t len);
+
+
+/**
+ * Return the largest contiguous region of stored bytes, to be drained in place
+ * @fifo: bfifo object
+ * @span: pointer where to store region start
+ * @return: region length in bytes. 0 if bfifo is empty or on wrong arguments
+ *
+ * Drained bytes are removed from bfifo with :c:func:`sk_bfifo_consume`
+ */
+sk_bfifo_len_t sk_bfifo_peek(sk_bfifo_t *fifo, const uint8_t **span);
+
+
+/**
+ * Remove bytes read from region returned by :c:func:`sk_bfifo_peek`
+ * @fifo: bfifo object
+ * @len: number of bytes read from region start
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if `len` exceeds the region
+ */
+sk_err sk_bfifo_consume(sk_bfifo_t *fifo, sk_bfifo_len_t len);
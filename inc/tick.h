@@ -1,3 +1,4 @@
+#pragma once
 /**
  * libsk tick - provides support for system ticks
  * 
@@ -17,6 +18,13 @@
 extern volatile uint32_t __sk_nticks;
 
 
+/**
+ * Higher 32 bits of system tick counter. Incremented each time :c:data:`__sk_nticks` wraps.
+ * Should not be used directly. Use :c:func:`sk_time_now_ns` and friends instead.
+ */
+extern volatile uint32_t __sk_nticks_hi;
+
+
 /** Returns current system tick counter (:c:data:`__sk_nticks`) value */
 inline sk_attr_alwaysinline uint32_t sk_tick_get_current(void)
 {
@@ -24,6 +32,18 @@ inline sk_attr_alwaysinline uint32_t sk_tick_get_current(void)
 }
 
 
+/** Returns current 64-bit system tick counter value, which never wraps in practice */
+inline sk_attr_alwaysinline uint64_t sk_tick_get_current64(void)
+{
+	uint32_t hi, lo;
+	do {
+		hi = __sk_nticks_hi;
+		lo = __sk_nticks;
+	} while (hi != __sk_nticks_hi);		// lower word wrapped in between
+	return ((uint64_t)hi << 32) | lo;
+}
+
+
 /**
  * Set current system tick counter (:c:data:`__sk_nticks`) value.
  * Note:
@@ -43,7 +63,8 @@ inline sk_attr_alwaysinline void __sk_tick_set_current(uint32_t val)
  */
 inline sk_attr_alwaysinline void __sk_tick_inc_callback(void)
 {
-	__sk_nticks++;
+	if (0 == ++__sk_nticks)
+		__sk_nticks_hi++;
 }
 
 
@@ -82,5 +103,59 @@ uint32_t sk_get_tick_rate_hz(void);
  * Use tick counter to provide millisecond delays.
  * Note:
  * Puts MCU to sleep using WFI instruction regularly until the desired tick value is reached.
+ * With :c:macro:`SK_USE_TICKLESS` set, uses :c:func:`sk_tick_idle`, so MCU is not woken up
+ * by ticks during the delay.
  */
 void sk_tick_delay_ms(uint32_t ms);
+
+
+/**
+ * Sleep for up to the specified number of ticks without tick interrupts (tickless idle)
+ * @nticks: maximum number of ticks to sleep
+ * @return: number of ticks elapsed
+ *
+ * SysTick is reprogrammed to fire at the deadline and the MCU is put to sleep with WFI.
+ * When woken up earlier by other interrupt, elapsed whole ticks are added to tick counter,
+ * and SysTick is reprogrammed to fire at the original tick boundary. So after return
+ * :c:func:`sk_tick_get_current` and :c:func:`sk_time_now_raw` are consistent, as if ticks
+ * were running all the time (up to a few cycles lost on reprogramming).
+ *
+ * Single sleep is limited by 24-bit SysTick counter, so fewer ticks than requested may pass.
+ * Callers should loop until their deadline is reached.
+ *
+ * Note:
+ * Tick ISR does not run for skipped ticks, so anything else called from overriden
+ * :c:func:`sys_tick_handler` (i.e. debouncer sampling) is skipped as well.
+ */
+uint32_t sk_tick_idle(uint32_t nticks);
+
+
+/**
+ * Return monotonic time in SysTick clock periods since :c:func:`sk_tick_init`
+ * @return: 64-bit number of SysTick counter decrements
+ *
+ * Combines tick counter with current SysTick counter value, so resolution is a single CPU
+ * cycle (or 8 cycles when divider by 8 is used) regardless of tick rate.
+ * Correct when called with interrupts disabled or from ISR with priority higher than
+ * SysTick, as long as tick interrupt is not held pending for more than one tick period.
+ * Rate of the returned value is given by :c:func:`sk_time_get_rate_hz`
+ */
+uint64_t sk_time_now_raw(void);
+
+
+/** Return rate of :c:func:`sk_time_now_raw` in Hz */
+uint32_t sk_time_get_rate_hz(void);
+
+
+/**
+ * Return monotonic time in nanoseconds since :c:func:`sk_tick_init`
+ * Same as :c:func:`sk_time_now_raw`, but converted to nanoseconds
+ */
+uint64_t sk_time_now_ns(void);
+
+
+/**
+ * Return monotonic time in microseconds since :c:func:`sk_tick_init`
+ * Same as :c:func:`sk_time_now_raw`, but converted to microseconds
+ */
+uint64_t sk_time_now_us(void);
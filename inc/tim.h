@@ -0,0 +1,34 @@
+#pragma once
+/**
+ * libsk timer helpers - common routines for modules built on top of STM32 timers
+ */
+
+#include "errors.h"
+#include <stdint.h>
+
+
+/**
+ * Return kernel clock frequency of a timer in Hz
+ * @tim: timer base address as in libopencm3 (TIM1 .. TIM14)
+ *
+ * Timers on APB1 and APB2 are clocked at double bus frequency when corresponding bus
+ * prescaler is not 1 (see p. 7.2 Clocks in RM0090).
+ * Result is based on :c:data:`rcc_apb1_frequency` and :c:data:`rcc_apb2_frequency`, so these must
+ * be kept up to date when changing clock configuration.
+ */
+uint32_t sk_tim_get_clock(uint32_t tim);
+
+
+/**
+ * Solve prescaler and period for desired update rate
+ * @clock: timer kernel clock in Hz (i.e. from :c:func:`sk_tim_get_clock`)
+ * @rate_hz: desired update event rate
+ * @maxperiod: maximum period value (0xFFFF for 16-bit timers, 0xFFFFFFFF for TIM2, TIM5)
+ * @psc: pointer where to store prescaler register value (PSC)
+ * @arr: pointer where to store auto-reload register value (ARR)
+ * @return: :c:macro:`SK_EOK` on success, :c:macro:`SK_ERANGE` if rate can not be reached
+ *
+ * Prescaler is chosen as small as possible to keep the best resolution
+ */
+sk_err sk_tim_solve_rate(uint32_t clock, uint32_t rate_hz, uint32_t maxperiod,
+						 uint32_t *psc, uint32_t *arr);
@@ -0,0 +1,119 @@
+#pragma once
+/**
+ * libsk waveform engine - outputs precomputed patterns on GPIO port with zero CPU load
+ *
+ * Pattern is an array of 32-bit GPIO BSRR words. Timer update event paces DMA, which copies
+ * pattern words one by one to port BSRR, cycling over the pattern endlessly.
+ * Each word sets pins in its lower half and resets pins in its higher half, pins with both
+ * halves zero are left untouched. So several engines (or CPU) may share the same port.
+ *
+ * Resources used: TIM8 (update event) and DMA2 Stream 1 Channel 7.
+ * Only DMA2 has access to AHB1 bus, where GPIO ports reside.
+ */
+
+#include "errors.h"
+#include "macro.h"
+#include "pin.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**
+ * Waveform engine object.
+ * Pattern is double-buffered. User fills back buffer (see :c:func:`sk_wave_get_back`)
+ * and then calls :c:func:`sk_wave_swap`. The new pattern is picked up by DMA exactly at the
+ * end of the current one, so no glitches occur.
+ */
+struct sk_wave {
+	/** Two pattern buffers of :c:member:`sk_wave.len` BSRR words each */
+	uint32_t *buf[2];
+	/** Pattern length (number of BSRR words) */
+	uint16_t len;
+	/** Port value as :c:type:`sk_port` */
+	uint8_t port;
+	// Fields below are shared with ISR, so they are not packed into bitfields
+	/** Private: index of buffer currently output by DMA */
+	volatile uint8_t __front;
+	/** Private: number of DMA address registers left to update by pending swap (0 .. 2) */
+	volatile uint8_t __swapstage;
+	/** Private: set while engine is running */
+	volatile bool __isrunning;
+};
+
+
+/**
+ * Initialize waveform engine
+ * @wave: waveform object (:c:type:`sk_wave`)
+ * @port: GPIO port to output pattern to
+ * @buf0: first pattern buffer. Output first when started
+ * @buf1: second pattern buffer
+ * @len: number of BSRR words in each buffer
+ * @rate_hz: pattern step rate. Timer prescaler and period are solved from TIM8 clock
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EWRONGARG` on wrong arguments,
+ *          :c:macro:`SK_ERANGE` if rate can not be reached with current clock settings
+ *
+ * Pins must already be configured as outputs. Engine is left stopped.
+ */
+sk_err sk_wave_init(struct sk_wave *wave, enum sk_port port, uint32_t *buf0, uint32_t *buf1,
+					uint16_t len, uint32_t rate_hz);
+
+
+/** Start pattern output */
+void sk_wave_start(struct sk_wave *wave);
+
+
+/** Stop pattern output. Pins keep their last levels */
+void sk_wave_stop(struct sk_wave *wave);
+
+
+/**
+ * Return back buffer, which is safe to modify
+ * @wave: waveform object (:c:type:`sk_wave`)
+ * @return: pointer to back buffer or NULL while previous swap is still pending
+ */
+uint32_t *sk_wave_get_back(struct sk_wave *wave);
+
+
+/**
+ * Make back buffer the one being output
+ * @wave: waveform object (:c:type:`sk_wave`)
+ * @return: :c:macro:`SK_EOK` on success,
+ *          :c:macro:`SK_EUNAVAILABLE` if previous swap is still pending
+ *
+ * Swap takes place when DMA reaches the end of the current pattern. Until then,
+ * :c:func:`sk_wave_get_back` returns NULL
+ */
+sk_err sk_wave_swap(struct sk_wave *wave);
+
+
+/**
+ * Clear pattern, so that it does not affect any pins
+ * @buf: pattern buffer
+ * @len: number of BSRR words in buffer
+ */
+void sk_wave_pattern_clear(uint32_t *buf, uint16_t len);
+
+
+/**
+ * Put PWM for a set of pins into pattern
+ * @buf: pattern buffer
+ * @len: number of BSRR words in buffer. This is the PWM period in steps
+ * @pins: 16-bit mask of port pins
+ * @duty: number of steps pins are high (0 .. len)
+ *
+ * Only words related to specified pins are changed, so calling this for different pins with
+ * different duty values gives multi-pin PWM. Inversion should be handled by caller.
+ */
+void sk_wave_pattern_pwm(uint32_t *buf, uint16_t len, uint16_t pins, uint16_t duty);
+
+
+/**
+ * Default DMA2 Stream 1 ISR used by waveform engine to complete buffer swap.
+ * User may override it, but should call :c:func:`__sk_wave_dma_callback` from there.
+ */
+void sk_attr_weak dma2_stream1_isr(void);
+
+
+/** DMA transfer complete callback. Intended for private use */
+void __sk_wave_dma_callback(void);
@@ -0,0 +1,126 @@
+/**
+ * libsk debouncer
+ */
+
+#include "debounce.h"
+#include "intrinsics.h"
+#include <stddef.h>
+
+
+sk_err sk_debounce_init(struct sk_debounce *db, struct sk_debounce_port *ports, uint8_t nports,
+						struct sk_debounce_event *evbuf, uint16_t evlen, uint32_t longpress)
+{
+	if ((NULL == db) || (NULL == ports) || (0 == nports) || (NULL == evbuf) || (evlen < 2))
+		return SK_EWRONGARG;
+
+	for (uint8_t i = 0; i < nports; i++) {
+		if (ports[i].port >= SK_PORT_COUNT)
+			return SK_EWRONGARG;
+	}
+
+	db->ports = ports;
+	db->nports = nports;
+	db->longpress = longpress;
+	db->evbuf = evbuf;
+	db->evlen = evlen;
+	db->__rdidx = 0;
+	db->__wridx = 0;
+	db->__nsamples = 0;
+	db->nlost = 0;
+
+	for (uint8_t i = 0; i < nports; i++) {
+		struct sk_debounce_port *p = &ports[i];
+		uint16_t idr = GPIO_IDR(sk_pin_port_to_gpio(p->port));
+		p->__state = (idr ^ p->inversions) & p->pins;
+		p->__cnt0 = 0;
+		p->__cnt1 = 0;
+		// pins held since init should not report long-press they were not pressed for
+		p->__longdone = p->__state;
+	}
+	return SK_EOK;
+}
+
+
+/** Put event into queue. Only called from sampling context (private) */
+static void debounce_push(struct sk_debounce *db, uint8_t port, uint8_t pin, uint8_t type)
+{
+	uint16_t wr = db->__wridx;
+	uint16_t next = (wr + 1) % db->evlen;
+	if (next == db->__rdidx) {
+		db->nlost++;
+		return;
+	}
+	db->evbuf[wr] = (struct sk_debounce_event){ .port = port, .pin = pin, .type = type };
+	__DMB();	// event must be in memory before reader can see the new index
+	db->__wridx = next;
+}
+
+
+/** Report event for every pin in mask (private) */
+static void debounce_push_mask(struct sk_debounce *db, uint8_t port, uint16_t mask, uint8_t type)
+{
+	while (mask) {
+		uint8_t pin = __builtin_ctz(mask);
+		mask &= mask - 1;	// clear lowest bit set
+		debounce_push(db, port, pin, type);
+	}
+}
+
+
+void sk_debounce_sample(struct sk_debounce *db)
+{
+	uint32_t now = ++db->__nsamples;
+
+	for (uint8_t i = 0; i < db->nports; i++) {
+		struct sk_debounce_port *p = &db->ports[i];
+		uint16_t sample = (GPIO_IDR(sk_pin_port_to_gpio(p->port)) ^ p->inversions) & p->pins;
+
+		// Vertical counter. Counters of pins equal to debounced state are held at 0,
+		// the others count up on each sample. Pins whose counters wrap around toggle
+		uint16_t delta = sample ^ p->__state;
+		p->__cnt1 = (p->__cnt1 ^ p->__cnt0) & delta;
+		p->__cnt0 = ~p->__cnt0 & delta;
+		uint16_t toggle = delta & ~(p->__cnt0 | p->__cnt1);
+		p->__state ^= toggle;
+
+		if (toggle) {
+			uint16_t pressed = toggle & p->__state;
+			uint16_t released = toggle & ~p->__state;
+			for (uint16_t m = pressed; m; m &= m - 1)
+				p->__presstime[__builtin_ctz(m)] = now;
+			p->__longdone &= ~toggle;
+			debounce_push_mask(db, p->port, pressed, SK_DEBOUNCE_PRESS);
+			debounce_push_mask(db, p->port, released, SK_DEBOUNCE_RELEASE);
+		}
+
+		if (!db->longpress)
+			continue;
+
+		uint16_t waiting = p->__state & ~p->__longdone;
+		while (waiting) {
+			uint8_t pin = __builtin_ctz(waiting);
+			waiting &= waiting - 1;
+			if ((now - p->__presstime[pin]) >= db->longpress) {
+				p->__longdone |= (1 << pin);
+				debounce_push(db, p->port, pin, SK_DEBOUNCE_LONGPRESS);
+			}
+		}
+	}
+}
+
+
+sk_err sk_debounce_get_event(struct sk_debounce *db, struct sk_debounce_event *ev)
+{
+	if ((NULL == db) || (NULL == ev))
+		return SK_EWRONGARG;
+
+	uint16_t rd = db->__rdidx;
+	if (rd == db->__wridx)
+		return SK_EEMPTY;
+
+	__DMB();	// do not read event before index telling it is there
+	*ev = db->evbuf[rd];
+	__DMB();	// event must be read out before the slot is given back to writer
+	db->__rdidx = (rd + 1) % db->evlen;
+	return SK_EOK;
+}
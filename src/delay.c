@@ -0,0 +1,41 @@
+/**
+ * libsk delay
+ */
+
+#include "delay.h"
+#include <libopencm3/stm32/rcc.h>
+
+
+// Delays are split into chunks of this many us, so that cycles never overflow 32 bits
+// (1 s takes 168e6 cycles at 168 MHz)
+#define DELAY_US_CHUNK	1000000ul
+
+
+bool sk_delay_init(void)
+{
+	// sets TRCENA in DEMCR (otherwise DWT is not clocked) and then CYCCNTENA
+	return dwt_enable_cycle_counter();
+}
+
+
+void sk_delay_us(uint32_t us)
+{
+	uint32_t start = DWT_CYCCNT;	// take it early, so that setup below is counted in
+
+	if (!(DWT_CTRL & DWT_CTRL_CYCCNTENA)) {
+		sk_delay_init();
+		start = DWT_CYCCNT;
+	}
+
+	uint32_t cycles_per_us = (rcc_ahb_frequency + 999999) / 1000000;
+
+	while (us > DELAY_US_CHUNK) {
+		uint32_t chunk = DELAY_US_CHUNK * cycles_per_us;
+		while ((DWT_CYCCNT - start) < chunk);
+		start += chunk;
+		us -= DELAY_US_CHUNK;
+	}
+
+	uint32_t cycles = us * cycles_per_us;
+	while ((DWT_CYCCNT - start) < cycles);
+}
@@ -0,0 +1,146 @@
+/**
+ * libsk event loop
+ */
+
+#include "evloop.h"
+#include "delay.h"
+#include "intrinsics.h"
+#include "tick.h"
+#include <libopencm3/cm3/cortex.h>
+#include <stddef.h>
+
+
+sk_err sk_evloop_init(struct sk_evloop *loop, struct sk_evloop_queue *queues, uint8_t nqueues,
+					  struct sk_swtimer_wheel *wheel)
+{
+	if ((NULL == loop) || (NULL == queues) || (0 == nqueues) || (nqueues > SK_EVLOOP_MAXQUEUES))
+		return SK_EWRONGARG;
+
+	for (uint8_t i = 0; i < nqueues; i++) {
+		if ((NULL == queues[i].buf) || (queues[i].len < 2))
+			return SK_EWRONGARG;
+		queues[i].__rdidx = 0;
+		queues[i].__wridx = 0;
+		queues[i].nlost = 0;
+	}
+
+	loop->queues = queues;
+	loop->nqueues = nqueues;
+	loop->wheel = wheel;
+	loop->idlecycles = 0;
+	loop->__pending = 0;
+	loop->__isstopped = false;
+
+	sk_delay_init();
+	return SK_EOK;
+}
+
+
+sk_err sk_evloop_post(struct sk_evloop *loop, struct sk_evloop_handler *handler, uint32_t param)
+{
+	if ((NULL == loop) || (NULL == handler) || (NULL == handler->func)
+		|| (handler->prio >= loop->nqueues))
+		return SK_EWRONGARG;
+
+	struct sk_evloop_queue *q = &loop->queues[handler->prio];
+
+	// Posting may come from ISRs of any priority. Critical section is only a few instructions
+	bool masked = cm_mask_interrupts(true);
+	uint16_t next = (q->__wridx + 1) % q->len;
+	if (next == q->__rdidx) {
+		q->nlost++;
+		cm_mask_interrupts(masked);
+		return SK_EFULL;
+	}
+	q->buf[q->__wridx] = (struct sk_evloop_event){ .handler = handler, .param = param };
+	q->__wridx = next;
+	loop->__pending |= (1 << handler->prio);
+	cm_mask_interrupts(masked);
+	return SK_EOK;
+}
+
+
+/** Pop the oldest event of the highest priority queue (private) */
+static bool evloop_pop(struct sk_evloop *loop, struct sk_evloop_event *ev)
+{
+	bool masked = cm_mask_interrupts(true);
+	uint8_t pending = loop->__pending;
+	if (!pending) {
+		cm_mask_interrupts(masked);
+		return false;
+	}
+
+	uint8_t prio = __builtin_ctz(pending);
+	struct sk_evloop_queue *q = &loop->queues[prio];
+	*ev = q->buf[q->__rdidx];
+	q->__rdidx = (q->__rdidx + 1) % q->len;
+	if (q->__rdidx == q->__wridx)
+		loop->__pending = pending & ~(1 << prio);
+	cm_mask_interrupts(masked);
+	return true;
+}
+
+
+/** Run handler and update its statistics (private) */
+static void evloop_dispatch(const struct sk_evloop_event *ev)
+{
+	struct sk_evloop_handler *handler = ev->handler;
+	uint32_t start = sk_cycles_get_current();
+	handler->func(handler, ev->param);
+	uint32_t spent = sk_cycles_get_current() - start;
+
+	handler->nruns++;
+	handler->cycles += spent;
+	if (spent > handler->maxcycles)
+		handler->maxcycles = spent;
+}
+
+
+bool sk_evloop_run_once(struct sk_evloop *loop)
+{
+	// Deferred timers are put into list from tick ISR. Run them first, so that a busy queue
+	// can not delay them
+	if ((NULL != loop->wheel) && sk_swtimer_has_deferred(loop->wheel)) {
+		if (sk_swtimer_run_deferred(loop->wheel))
+			return true;
+	}
+
+	struct sk_evloop_event ev;
+	if (!evloop_pop(loop, &ev))
+		return false;
+	evloop_dispatch(&ev);
+	return true;
+}
+
+
+/** Sleep until there is something to do (private) */
+static void evloop_idle(struct sk_evloop *loop)
+{
+	// Check for work and go to sleep with interrupts masked. Otherwise an event posted
+	// in between is left unnoticed until the next interrupt. Masked interrupts still wake
+	// the core up, and are taken right after unmasking
+	bool masked = cm_mask_interrupts(true);
+	bool isbusy = loop->__pending
+				  || ((NULL != loop->wheel) && sk_swtimer_has_deferred(loop->wheel));
+	if (!isbusy) {
+		uint32_t start = sk_cycles_get_current();
+		if (NULL != loop->wheel) {
+			sk_tick_idle(sk_swtimer_get_idle_ticks(loop->wheel));
+		} else {
+			__DSB();
+			__WFI();
+		}
+		loop->idlecycles += sk_cycles_get_current() - start;
+	}
+	cm_mask_interrupts(masked);
+}
+
+
+void sk_evloop_run(struct sk_evloop *loop)
+{
+	loop->__isstopped = false;
+	while (!loop->__isstopped) {
+		if (!sk_evloop_run_once(loop))
+			evloop_idle(loop);
+	}
+}
@@ -0,0 +1,324 @@
+/**
+ * libsk EXTI dispatcher
+ */
+
+#include "exti.h"
+#include "delay.h"
+#include "intrinsics.h"
+#include "tick.h"
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/stm32/exti.h>
+#include <libopencm3/stm32/rcc.h>
+#include <stddef.h>
+
+
+/** State of EXTI line (private) */
+struct exti_line {
+	sk_exti_handler_t handler;
+	void *arg;
+	/** Debounce time in ticks, 0 if not used */
+	uint32_t debounce;
+	/** Tick at which line is to be unmasked */
+	volatile uint32_t deadline;
+	/** Port value as :c:type:`sk_port` */
+	uint8_t port;
+	bool isinverse;
+	bool isused;
+	/** Last reported pin value */
+	volatile uint8_t value;
+};
+
+
+static struct exti_line lines[16];
+
+// Event queue. Multiple producers (EXTI ISRs of different priorities and tick ISR),
+// single consumer. Write index is advanced with exclusive access, so producers preempting
+// each other get different slots. Slot is handed to consumer with its __ready flag
+static struct {
+	struct sk_exti_event *buf;
+	uint8_t len;
+	volatile uint8_t rdidx;
+	volatile uint8_t wridx;
+	volatile uint32_t nlost;
+} queue = { 0 };
+
+
+// Lines with debounce enabled. Only changed with the line disabled
+static volatile uint16_t debounce_lines = 0;
+
+
+/** Map EXTI line to its NVIC IRQ (private) */
+static uint8_t exti_line_irq(uint8_t line)
+{
+	static const uint8_t irqs[5] = {
+		NVIC_EXTI0_IRQ, NVIC_EXTI1_IRQ, NVIC_EXTI2_IRQ, NVIC_EXTI3_IRQ, NVIC_EXTI4_IRQ
+	};
+	if (line < 5)
+		return irqs[line];
+	return (line < 10) ? NVIC_EXTI9_5_IRQ : NVIC_EXTI15_10_IRQ;
+}
+
+
+/** Atomically mask or unmask EXTI line using bit-band alias of EXTI_IMR (private) */
+static inline void exti_line_mask(uint8_t line, bool ismasked)
+{
+	*(volatile uint32_t *)SK_BITBAND_PERIPH_ADDR(&EXTI_IMR, line) = !ismasked;
+}
+
+
+static inline uint8_t exti_line_read(const struct exti_line *l, uint8_t line)
+{
+	return ((GPIO_IDR(sk_pin_port_to_gpio(l->port)) >> line) & 1) ^ l->isinverse;
+}
+
+
+/** Put event into queue. Safe to call from any ISR (private) */
+static void queue_post(uint32_t time, uint8_t port, uint8_t pin, uint8_t value)
+{
+	uint8_t wr, next;
+	do {
+		wr = __LDREXB(&queue.wridx);
+		next = (wr + 1) % queue.len;
+		if (next == queue.rdidx) {
+			__CLREX();
+			// ISRs of different priorities may drop events at the same time
+			sk_atomic_add(&queue.nlost, 1);
+			return;
+		}
+	} while (__STREXB(next, &queue.wridx));
+
+	struct sk_exti_event *ev = &queue.buf[wr];
+	ev->time = time;
+	ev->port = port;
+	ev->pin = pin;
+	ev->value = value;
+	__DMB();	// event must be complete before consumer sees it ready
+	ev->__ready = 1;
+}
+
+
+sk_err sk_exti_init(struct sk_exti_event *evbuf, uint8_t evlen)
+{
+	if ((NULL == evbuf) || (evlen < 2))
+		return SK_EWRONGARG;
+
+	for (uint8_t line = 0; line < 16; line++) {
+		if (lines[line].isused)
+			sk_exti_detach((sk_pin){ .port = lines[line].port, .pin = line });
+	}
+
+	for (uint8_t i = 0; i < evlen; i++)
+		evbuf[i].__ready = 0;
+	queue.buf = evbuf;
+	queue.len = evlen;
+	queue.rdidx = 0;
+	queue.wridx = 0;
+	queue.nlost = 0;
+
+	sk_delay_init();	// cycle counter is used for timestamps
+	rcc_periph_clock_enable(RCC_SYSCFG);	// EXTI source selection lives in SYSCFG
+	return SK_EOK;
+}
+
+
+sk_err sk_exti_attach(sk_pin pin, enum sk_exti_edge edge, uint32_t debounce,
+					  sk_exti_handler_t handler, void *arg)
+{
+	if ((pin.port >= SK_PORT_COUNT) || (edge > SK_EXTI_BOTH) || (NULL == queue.buf))
+		return SK_EWRONGARG;
+
+	uint8_t line = pin.pin;
+	struct exti_line *l = &lines[line];
+	if (l->isused && (l->port != pin.port))
+		return SK_EUNAVAILABLE;
+
+	// Edge is given in terms of pin value, so swap edges for inverted pins
+	enum exti_trigger_type trig = EXTI_TRIGGER_BOTH;
+	if (SK_EXTI_ACTIVATE == edge)
+		trig = pin.isinverse ? EXTI_TRIGGER_FALLING : EXTI_TRIGGER_RISING;
+	else if (SK_EXTI_DEACTIVATE == edge)
+		trig = pin.isinverse ? EXTI_TRIGGER_RISING : EXTI_TRIGGER_FALLING;
+
+	// Tick callback unmasks debounced lines which are masked. So line must not be seen
+	// there until it is fully configured, or it would be unmasked with previous source
+	// and trigger. Interrupts are masked, so debounce_lines is also updated safely
+	uint32_t bit = 1 << line;
+	bool masked = cm_mask_interrupts(true);
+	exti_disable_request(bit);
+
+	l->handler = handler;
+	l->arg = arg;
+	l->debounce = debounce;
+	l->port = pin.port;
+	l->isinverse = pin.isinverse;
+	l->isused = true;
+
+	exti_select_source(bit, sk_pin_port_to_gpio(pin.port));
+	exti_set_trigger(bit, trig);
+	// drop request latched before, so that there is no phantom event
+	exti_reset_request(bit);
+	l->value = exti_line_read(l, line);
+	if (debounce)
+		debounce_lines |= bit;
+	else
+		debounce_lines &= ~bit;
+	exti_enable_request(bit);
+	cm_mask_interrupts(masked);
+
+	nvic_enable_irq(exti_line_irq(line));
+	return SK_EOK;
+}
+
+
+void sk_exti_detach(sk_pin pin)
+{
+	uint8_t line = pin.pin;
+	struct exti_line *l = &lines[line];
+	if (!l->isused || (l->port != pin.port))
+		return;
+
+	// Same as with attach: tick callback must not unmask the line being detached
+	uint32_t bit = 1 << line;
+	bool masked = cm_mask_interrupts(true);
+	debounce_lines &= ~bit;
+	exti_disable_request(bit);
+	exti_reset_request(bit);
+	l->isused = false;
+	l->handler = NULL;
+	cm_mask_interrupts(masked);
+	// IRQ stays enabled in NVIC, as it may be shared with other lines
+}
+
+
+sk_err sk_exti_get_event(struct sk_exti_event *ev)
+{
+	if ((NULL == ev) || (NULL == queue.buf))
+		return SK_EWRONGARG;
+
+	uint8_t rd = queue.rdidx;
+	struct sk_exti_event *slot = &queue.buf[rd];
+	if (!slot->__ready)
+		return SK_EEMPTY;
+
+	__DMB();	// do not read event before its ready flag
+	*ev = *slot;
+	slot->__ready = 0;
+	__DMB();	// slot must be released before producers can reuse it
+	queue.rdidx = (rd + 1) % queue.len;
+	return SK_EOK;
+}
+
+
+uint32_t sk_exti_dispatch(void)
+{
+	struct sk_exti_event ev;
+	uint32_t cnt = 0;
+	while (SK_EOK == sk_exti_get_event(&ev)) {
+		sk_exti_handler_t handler = lines[ev.pin].handler;
+		if ((NULL != handler) && (lines[ev.pin].port == ev.port))
+			handler(&ev, lines[ev.pin].arg);
+		cnt++;
+	}
+	return cnt;
+}
+
+
+uint32_t sk_exti_get_nlost(void)
+{
+	return queue.nlost;
+}
+
+
+void __sk_exti_callback(uint32_t linemask)
+{
+	uint32_t time = sk_cycles_get_current();		// take timestamp as early as possible
+	uint32_t pending = EXTI_PR & linemask & EXTI_IMR;
+	EXTI_PR = pending;	// PR bits are cleared by writing 1
+
+	while (pending) {
+		uint8_t line = __builtin_ctz(pending);
+		pending &= pending - 1;
+		struct exti_line *l = &lines[line];
+		uint8_t value = exti_line_read(l, line);
+		l->value = value;
+		queue_post(time, l->port, line, value);
+
+		if (debounce_lines & (1 << line)) {
+			// ignore bouncing until tick callback unmasks line
+			l->deadline = sk_tick_get_current() + l->debounce;
+			exti_line_mask(line, true);
+		}
+	}
+}
+
+
+void __sk_exti_tick_callback(void)
+{
+	// Debounced lines which are masked now are waiting for deadline
+	uint32_t waiting = debounce_lines & ~EXTI_IMR;
+	if (!waiting)
+		return;
+
+	uint32_t now = sk_tick_get_current();
+	while (waiting) {
+		uint8_t line = __builtin_ctz(waiting);
+		waiting &= waiting - 1;
+		struct exti_line *l = &lines[line];
+		if ((int32_t)(now - l->deadline) < 0)
+			continue;
+
+		// Line is masked, so its ISR part can not run concurrently
+		uint8_t value = exti_line_read(l, line);
+		if (value != l->value) {
+			// pin changed during debounce and the edge was swallowed. Report it now
+			l->value = value;
+			queue_post(sk_cycles_get_current(), l->port, line, value);
+		}
+		EXTI_PR = (1 << line);	// edges during debounce are still latched, drop them
+		exti_line_mask(line, false);
+	}
+}
+
+
+// EXTI default ISRs. May be overriden by user.
+void sk_attr_weak exti0_isr(void)
+{
+	__sk_exti_callback(1 << 0);
+}
+
+
+void sk_attr_weak exti1_isr(void)
+{
+	__sk_exti_callback(1 << 1);
+}
+
+
+void sk_attr_weak exti2_isr(void)
+{
+	__sk_exti_callback(1 << 2);
+}
+
+
+void sk_attr_weak exti3_isr(void)
+{
+	__sk_exti_callback(1 << 3);
+}
+
+
+void sk_attr_weak exti4_isr(void)
+{
+	__sk_exti_callback(1 << 4);
+}
+
+
+void sk_attr_weak exti9_5_isr(void)
+{
+	__sk_exti_callback(0x03E0);		// lines 5 .. 9
+}
+
+
+void sk_attr_weak exti15_10_isr(void)
+{
+	__sk_exti_callback(0xFC00);		// lines 10 .. 15
+}
@@ -0,0 +1,325 @@
+/**
+ * libsk input capture
+ */
+
+#include "icap.h"
+#include "tim.h"
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/timer.h>
+#include <stddef.h>
+
+
+// Burst DMA address is counted in words from TIMx_CR1. CCR1 is at 0x34 (see p. 17.4 RM0090)
+#define ICAP_DCR_DBA_CCR1	(0x34 / 4)
+// Burst length field holds the number of transfers minus one
+#define ICAP_DCR_DBL_2		(1 << 8)
+
+
+/** Timer resources (private) */
+struct icap_tim {
+	uint32_t tim;
+	enum rcc_periph_clken rcc;
+	enum rcc_periph_rst rst;
+	uint8_t irq;
+	bool is32bit;
+};
+
+
+/** DMA stream serving timer channel request (private) */
+struct icap_dma {
+	uint32_t dma;
+	uint8_t stream;
+	uint8_t chsel;
+	uint8_t irq;
+};
+
+
+static const struct icap_tim icap_tims[] = {
+	{ TIM1, RCC_TIM1, RST_TIM1, NVIC_TIM1_UP_TIM10_IRQ, false },
+	{ TIM2, RCC_TIM2, RST_TIM2, NVIC_TIM2_IRQ, true },
+	{ TIM3, RCC_TIM3, RST_TIM3, NVIC_TIM3_IRQ, false },
+	{ TIM4, RCC_TIM4, RST_TIM4, NVIC_TIM4_IRQ, false },
+	{ TIM5, RCC_TIM5, RST_TIM5, NVIC_TIM5_IRQ, true },
+	{ TIM8, RCC_TIM8, RST_TIM8, NVIC_TIM8_UP_TIM13_IRQ, false },
+};
+
+
+#define DMA1_S(s, ch)	{ DMA1, DMA_STREAM##s, ch, NVIC_DMA1_STREAM##s##_IRQ }
+#define DMA2_S(s, ch)	{ DMA2, DMA_STREAM##s, ch, NVIC_DMA2_STREAM##s##_IRQ }
+#define DMA_NONE		{ 0, 0, 0, 0 }
+
+// TIMx_CHy requests, rows as in icap_tims (see p. 10.3.3 RM0090, Tables 42, 43)
+static const struct icap_dma icap_dmas[][4] = {
+	{ DMA2_S(1, 6), DMA2_S(2, 6), DMA2_S(6, 6), DMA2_S(4, 6) },
+	{ DMA1_S(5, 3), DMA1_S(6, 3), DMA1_S(1, 3), DMA1_S(7, 3) },
+	{ DMA1_S(4, 5), DMA1_S(5, 5), DMA1_S(7, 5), DMA1_S(2, 5) },
+	{ DMA1_S(0, 2), DMA1_S(3, 2), DMA1_S(7, 2), DMA_NONE },
+	{ DMA1_S(2, 6), DMA1_S(4, 6), DMA1_S(0, 6), DMA1_S(1, 6) },
+	{ DMA2_S(2, 7), DMA2_S(3, 7), DMA2_S(4, 7), DMA2_S(7, 7) },
+};
+
+#undef DMA1_S
+#undef DMA2_S
+#undef DMA_NONE
+
+
+static inline const struct icap_dma *icap_get_dma(const struct sk_icap *ic)
+{
+	return &icap_dmas[ic->__timidx][ic->channel - 1];
+}
+
+
+sk_err sk_icap_init(struct sk_icap *ic, uint32_t tim, uint8_t channel, uint32_t *buf,
+					uint16_t len, uint32_t tick_hz, uint8_t irq_priority)
+{
+	if ((NULL == ic) || (NULL == buf) || (0 == len) || (len % 4) || (0 == tick_hz) ||
+		(channel < 1) || (channel > 4))
+		return SK_EWRONGARG;
+
+	uint8_t idx = 0;
+	while ((idx < sk_arr_len(icap_tims)) && (icap_tims[idx].tim != tim))
+		idx++;
+	if ((idx >= sk_arr_len(icap_tims)) || (0 == icap_dmas[idx][channel - 1].dma))
+		return SK_EUNAVAILABLE;
+
+	uint32_t clock = sk_tim_get_clock(tim);
+	uint32_t psc = (clock + tick_hz / 2) / tick_hz;
+	if ((0 == psc) || (psc > 0x10000))
+		return SK_ERANGE;
+
+	const struct icap_tim *t = &icap_tims[idx];
+	const struct icap_dma *d = &icap_dmas[idx][channel - 1];
+	ic->buf = buf;
+	ic->len = len;
+	ic->channel = channel;
+	ic->tim = tim;
+	ic->tick_hz = clock / psc;
+	ic->__timidx = idx;
+	ic->__mask = t->is32bit ? 0xFFFFFFFF : 0xFFFF;
+	ic->__isrunning = false;
+
+	rcc_periph_clock_enable(t->rcc);
+	rcc_periph_clock_enable((DMA1 == d->dma) ? RCC_DMA1 : RCC_DMA2);
+
+	rcc_periph_reset_pulse(t->rst);
+	timer_set_prescaler(tim, psc - 1);
+	timer_set_period(tim, ic->__mask);
+	// Only overflow sets UIF, so UG below does not produce interrupt
+	timer_update_on_overflow(tim);
+	timer_generate_event(tim, TIM_EGR_UG);	// load prescaler
+	timer_clear_flag(tim, TIM_SR_UIF);
+
+	// Measured channel captures rising edges of its own input, paired channel captures
+	// falling edges of the same input. Pairs are 1-2 and 3-4, i.e. 0-1 and 2-3 as tim_ic_id
+	enum tim_ic_id ic_rise = channel - 1;
+	enum tim_ic_id ic_fall = ic_rise ^ 1;
+	enum tim_ic_input in = (ic_rise < TIM_IC3) ? (TIM_IC_IN_TI1 + ic_rise)
+											   : (TIM_IC_IN_TI3 + ic_rise - TIM_IC3);
+	timer_ic_set_input(tim, ic_rise, in);
+	timer_ic_set_input(tim, ic_fall, in);
+	// CCxP is shared by input and output modes. OC ids for main channels are 0, 2, 4, 6
+	timer_set_oc_polarity_high(tim, (enum tim_oc_id)(ic_rise * 2));
+	timer_set_oc_polarity_low(tim, (enum tim_oc_id)(ic_fall * 2));
+	timer_ic_enable(tim, ic_rise);
+	timer_ic_enable(tim, ic_fall);
+
+	// Each rising edge request reads both CCRs of the pair in one burst
+	TIM_DCR(tim) = ICAP_DCR_DBL_2 | (ICAP_DCR_DBA_CCR1 + (ic_rise & ~1u));
+
+	dma_stream_reset(d->dma, d->stream);
+	dma_channel_select(d->dma, d->stream, (uint32_t)d->chsel << DMA_SxCR_CHSEL_SHIFT);
+	dma_set_priority(d->dma, d->stream, DMA_SxCR_PL_HIGH);
+	dma_set_transfer_mode(d->dma, d->stream, DMA_SxCR_DIR_PERIPHERAL_TO_MEM);
+	dma_set_memory_size(d->dma, d->stream, DMA_SxCR_MSIZE_32BIT);
+	dma_set_peripheral_size(d->dma, d->stream, DMA_SxCR_PSIZE_32BIT);
+	dma_enable_memory_increment_mode(d->dma, d->stream);
+	dma_disable_peripheral_increment_mode(d->dma, d->stream);
+	dma_enable_direct_mode(d->dma, d->stream);
+	dma_enable_circular_mode(d->dma, d->stream);
+	dma_set_peripheral_address(d->dma, d->stream, (uint32_t)&TIM_DMAR(tim));
+	dma_enable_half_transfer_interrupt(d->dma, d->stream);
+	dma_enable_transfer_complete_interrupt(d->dma, d->stream);
+
+	nvic_set_priority(t->irq, irq_priority);
+	nvic_set_priority(d->irq, irq_priority);
+	nvic_enable_irq(t->irq);
+	nvic_enable_irq(d->irq);
+	return SK_EOK;
+}
+
+
+void sk_icap_start(struct sk_icap *ic)
+{
+	if ((NULL == ic) || ic->__isrunning)
+		return;
+
+	const struct icap_dma *d = icap_get_dma(ic);
+	ic->__rpos = 0;
+	ic->__base = 0;
+	ic->__hasrise = false;
+	ic->__res = (struct sk_icap_result){ .tick_hz = ic->tick_hz };
+
+	dma_set_memory_address(d->dma, d->stream, (uint32_t)ic->buf);
+	dma_set_number_of_data(d->dma, d->stream, ic->len);
+	dma_clear_interrupt_flags(d->dma, d->stream, DMA_HTIF | DMA_TCIF);
+	dma_enable_stream(d->dma, d->stream);
+
+	ic->__isrunning = true;
+	timer_set_counter(ic->tim, 0);
+	timer_clear_flag(ic->tim, TIM_SR_UIF);
+	timer_enable_irq(ic->tim, TIM_DIER_UIE | (TIM_DIER_CC1DE << (ic->channel - 1)));
+	timer_enable_counter(ic->tim);
+}
+
+
+/**
+ * Extend and accumulate captures written since the previous call (private)
+ *
+ * Only the latest rising edge is placed relative to the current time, as it is the only one
+ * known to be captured less than one overflow period ago. Older edges are placed relative to
+ * the next one, going backwards. Edges of a single batch span about one overflow period,
+ * as batches are processed at least on every overflow.
+ */
+static void icap_process(struct sk_icap *ic)
+{
+	const struct icap_dma *d = icap_get_dma(ic);
+	uint32_t mask = ic->__mask;
+
+	// Position is read before counter, so all captures up to it precede the counter value.
+	// Burst may be in progress, so partial pair is left for the next time
+	uint16_t wpos = ((ic->len - dma_get_number_of_data(d->dma, d->stream)) % ic->len) & ~1u;
+	uint32_t cnt = timer_get_counter(ic->tim);
+	uint64_t now = ic->__base + cnt;
+	if (timer_get_flag(ic->tim, TIM_SR_UIF) && (cnt <= mask / 2))
+		now += (uint64_t)mask + 1;	// overflow not accounted yet
+
+	uint16_t npairs = ((wpos + ic->len - ic->__rpos) % ic->len) / 2;
+	if (0 == npairs)
+		return;
+
+	// Rising edge capture of the measured channel and falling edge one of its pair
+	uint8_t riseidx = (ic->channel - 1) & 1;
+	uint8_t fallidx = riseidx ^ 1;
+	struct sk_icap_result *res = &ic->__res;
+
+	uint16_t pos = wpos;
+	uint32_t nextraw = cnt;
+	uint64_t rise = now, latest = 0, fall = 0;
+	bool haswidth = false;
+	for (uint16_t i = 0; i < npairs; i++) {
+		pos = (pos + ic->len - 2) % ic->len;
+		uint32_t riseraw = ic->buf[pos + riseidx] & mask;
+		uint32_t fallraw = ic->buf[pos + fallidx] & mask;
+		rise -= (nextraw - riseraw) & mask;
+		nextraw = riseraw;
+
+		if (0 == i) {
+			latest = rise;
+		} else {
+			if (1 == i)
+				res->lastperiod = latest - rise;
+			// fall is the falling edge which follows this rising edge
+			uint32_t width = fall - rise;
+			res->sumwidth += width;
+			if (!haswidth)
+				res->lastwidth = width;
+			haswidth = true;
+		}
+		// Falling edge captured before this rising one is the latest before it
+		fall = rise - ((riseraw - fallraw) & mask);
+	}
+
+	if (ic->__hasrise) {
+		if (1 == npairs)
+			res->lastperiod = latest - ic->__lastrise;
+		uint32_t width = fall - ic->__lastrise;
+		res->sumwidth += width;
+		if (!haswidth)
+			res->lastwidth = width;
+		res->sumperiod += latest - ic->__lastrise;
+		res->nperiods += npairs;
+	} else {
+		res->sumperiod += latest - rise;
+		res->nperiods += npairs - 1;
+	}
+
+	ic->__lastrise = latest;
+	ic->__hasrise = true;
+	ic->__rpos = wpos;
+}
+
+
+void sk_icap_stop(struct sk_icap *ic)
+{
+	if ((NULL == ic) || !ic->__isrunning)
+		return;
+
+	const struct icap_dma *d = icap_get_dma(ic);
+	bool masked = cm_mask_interrupts(true);
+	timer_disable_irq(ic->tim, TIM_DIER_UIE | (TIM_DIER_CC1DE << (ic->channel - 1)));
+	// Captures collected so far stay available to sk_icap_read
+	icap_process(ic);
+	timer_disable_counter(ic->tim);
+	ic->__isrunning = false;
+	cm_mask_interrupts(masked);
+
+	dma_disable_stream(d->dma, d->stream);
+	while (DMA_SCR(d->dma, d->stream) & DMA_SxCR_EN);	// EN clears when stream stops
+}
+
+
+sk_err sk_icap_read(struct sk_icap *ic, struct sk_icap_result *res)
+{
+	if ((NULL == ic) || (NULL == res))
+		return SK_EWRONGARG;
+
+	bool masked = cm_mask_interrupts(true);
+	if (ic->__isrunning)
+		icap_process(ic);
+	*res = ic->__res;
+	ic->__res = (struct sk_icap_result){ .tick_hz = ic->tick_hz };
+	cm_mask_interrupts(masked);
+	return SK_EOK;
+}
+
+
+uint32_t sk_icap_get_freq_hz(const struct sk_icap_result *res, uint16_t *millihz)
+{
+	uint32_t hz = 0;
+	uint16_t frac = 0;
+	if ((NULL != res) && (0 != res->sumperiod)) {
+		// f = tick_hz * nperiods / sumperiod. Split to keep fractional part within 64 bits
+		uint64_t num = (uint64_t)res->tick_hz * res->nperiods;
+		hz = num / res->sumperiod;
+		frac = (num % res->sumperiod) * 1000 / res->sumperiod;
+	}
+	if (NULL != millihz)
+		*millihz = frac;
+	return hz;
+}
+
+
+uint16_t sk_icap_get_duty_permille(const struct sk_icap_result *res)
+{
+	if ((NULL == res) || (0 == res->sumperiod))
+		return 0;
+	return (res->sumwidth * 1000 + res->sumperiod / 2) / res->sumperiod;
+}
+
+
+void sk_icap_irq_handler(struct sk_icap *ic)
+{
+	if ((NULL == ic) || !ic->__isrunning)
+		return;
+
+	const struct icap_dma *d = icap_get_dma(ic);
+	dma_clear_interrupt_flags(d->dma, d->stream, DMA_HTIF | DMA_TCIF);
+	if (timer_get_flag(ic->tim, TIM_SR_UIF)) {
+		timer_clear_flag(ic->tim, TIM_SR_UIF);
+		ic->__base += (uint64_t)ic->__mask + 1;
+	}
+	icap_process(ic);
+}
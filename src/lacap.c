@@ -0,0 +1,311 @@
+/**
+ * libsk logic analyzer capture
+ */
+
+#include "lacap.h"
+#include "tim.h"
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/timer.h>
+#include <stddef.h>
+
+
+// TIM1_UP request is routed to DMA2 Stream 5 Channel 6 (see p. 9.3.3 RM0090, Table 43)
+#define LACAP_TIM		TIM1
+#define LACAP_DMA		DMA2
+#define LACAP_STREAM	DMA_STREAM5
+#define LACAP_CHANNEL	DMA_SxCR_CHSEL_6
+#define LACAP_IRQ		NVIC_DMA2_STREAM5_IRQ
+
+
+// There is only one set of hardware resources, so only one capture may be active at a time
+static struct sk_lacap *active_cap = NULL;
+
+
+sk_err sk_lacap_init(struct sk_lacap *cap, enum sk_port port, uint16_t *buf, uint16_t len,
+					 uint32_t rate_hz)
+{
+	if ((NULL == cap) || (NULL == buf) || (0 == len) || (len % 2) || (0 == rate_hz))
+		return SK_EWRONGARG;
+
+	uint32_t clock = sk_tim_get_clock(LACAP_TIM);
+	uint32_t psc, arr;
+	if (SK_EOK != sk_tim_solve_rate(clock, rate_hz, 0xFFFF, &psc, &arr))
+		return SK_ERANGE;
+
+	if (NULL != active_cap)
+		sk_lacap_stop(active_cap);
+
+	cap->buf = buf;
+	cap->len = len;
+	cap->port = port;
+	cap->rate_hz = clock / ((psc + 1) * (arr + 1));
+	cap->__istrigused = false;
+	cap->__isrunning = false;
+	cap->__trigidx = -1;
+	cap->__postleft = 0;
+	cap->__start = 0;
+	cap->__prevmatch = false;
+	active_cap = cap;
+
+	rcc_periph_clock_enable(RCC_TIM1);
+	rcc_periph_clock_enable(RCC_DMA2);
+
+	rcc_periph_reset_pulse(RST_TIM1);
+	timer_set_prescaler(LACAP_TIM, psc);
+	timer_set_period(LACAP_TIM, arr);
+	timer_enable_preload(LACAP_TIM);
+	// Request DMA transfer on every update event
+	timer_enable_irq(LACAP_TIM, TIM_DIER_UDE);
+
+	dma_stream_reset(LACAP_DMA, LACAP_STREAM);
+	dma_channel_select(LACAP_DMA, LACAP_STREAM, LACAP_CHANNEL);
+	dma_set_priority(LACAP_DMA, LACAP_STREAM, DMA_SxCR_PL_VERY_HIGH);
+	dma_set_transfer_mode(LACAP_DMA, LACAP_STREAM, DMA_SxCR_DIR_PERIPHERAL_TO_MEM);
+	dma_set_memory_size(LACAP_DMA, LACAP_STREAM, DMA_SxCR_MSIZE_16BIT);
+	dma_set_peripheral_size(LACAP_DMA, LACAP_STREAM, DMA_SxCR_PSIZE_16BIT);
+	dma_enable_memory_increment_mode(LACAP_DMA, LACAP_STREAM);
+	dma_disable_peripheral_increment_mode(LACAP_DMA, LACAP_STREAM);
+	dma_enable_direct_mode(LACAP_DMA, LACAP_STREAM);
+	dma_enable_circular_mode(LACAP_DMA, LACAP_STREAM);
+	dma_set_peripheral_address(LACAP_DMA, LACAP_STREAM,
+							   (uint32_t)&GPIO_IDR(sk_pin_port_to_gpio(port)));
+
+	nvic_enable_irq(LACAP_IRQ);
+	return SK_EOK;
+}
+
+
+sk_err sk_lacap_start(struct sk_lacap *cap, const struct sk_lacap_trig *trig, uint16_t posttrig)
+{
+	if ((NULL == cap) || (cap != active_cap))
+		return SK_EWRONGARG;
+	// Trigger is at most posttrig + len / 2 samples before the end of the last captured half.
+	// Keep margin, so that DMA running on until stop does not reach it
+	if ((NULL != trig) && ((int32_t)posttrig > (int32_t)cap->len / 2 - SK_LACAP_POSTTRIG_MARGIN))
+		return SK_EWRONGARG;
+
+	if (cap->__isrunning)
+		sk_lacap_stop(cap);
+
+	cap->__istrigused = (NULL != trig);
+	if (NULL != trig)
+		cap->__trig = *trig;
+	cap->__trigidx = -1;
+	cap->__postleft = posttrig;
+	cap->__prevmatch = false;
+	cap->__start = 0;
+
+	dma_set_memory_address(LACAP_DMA, LACAP_STREAM, (uint32_t)cap->buf);
+	dma_set_number_of_data(LACAP_DMA, LACAP_STREAM, cap->len);
+	dma_clear_interrupt_flags(LACAP_DMA, LACAP_STREAM, DMA_HTIF | DMA_TCIF);
+	// Free-running capture needs no CPU at all. Trigger needs each ring half scanned
+	if (cap->__istrigused) {
+		dma_enable_half_transfer_interrupt(LACAP_DMA, LACAP_STREAM);
+		dma_enable_transfer_complete_interrupt(LACAP_DMA, LACAP_STREAM);
+	} else {
+		dma_disable_half_transfer_interrupt(LACAP_DMA, LACAP_STREAM);
+		dma_disable_transfer_complete_interrupt(LACAP_DMA, LACAP_STREAM);
+	}
+
+	cap->__isrunning = true;
+	dma_enable_stream(LACAP_DMA, LACAP_STREAM);
+	timer_set_counter(LACAP_TIM, 0);
+	timer_enable_counter(LACAP_TIM);
+	return SK_EOK;
+}
+
+
+void sk_lacap_stop(struct sk_lacap *cap)
+{
+	if ((NULL == cap) || (cap != active_cap) || !cap->__isrunning)
+		return;
+
+	// Stop requests first, so that position read below stays valid
+	timer_disable_counter(LACAP_TIM);
+	uint16_t left = dma_get_number_of_data(LACAP_DMA, LACAP_STREAM);
+	dma_disable_stream(LACAP_DMA, LACAP_STREAM);
+	while (DMA_SCR(LACAP_DMA, LACAP_STREAM) & DMA_SxCR_EN);	// EN clears when stream stops
+	dma_disable_half_transfer_interrupt(LACAP_DMA, LACAP_STREAM);
+	dma_disable_transfer_complete_interrupt(LACAP_DMA, LACAP_STREAM);
+
+	// Next position to be written holds the oldest sample
+	cap->__start = (cap->len - left) % cap->len;
+	cap->__isrunning = false;
+}
+
+
+int32_t sk_lacap_get_trigger(const struct sk_lacap *cap)
+{
+	if ((NULL == cap) || (cap->__trigidx < 0))
+		return -1;
+	return (cap->__trigidx + cap->len - cap->__start) % cap->len;
+}
+
+
+uint16_t sk_lacap_get_sample(const struct sk_lacap *cap, uint16_t idx)
+{
+	return cap->buf[((uint32_t)cap->__start + idx) % cap->len];
+}
+
+
+/** Scan ring part for trigger. Returns index of trigger sample or -1 (private) */
+static int32_t lacap_scan(struct sk_lacap *cap, uint16_t from, uint16_t to)
+{
+	const struct sk_lacap_trig trig = cap->__trig;
+	bool prev = cap->__prevmatch;
+	for (uint16_t i = from; i < to; i++) {
+		bool match = ((cap->buf[i] & trig.mask) == trig.value);
+		if (match && !(trig.onenter && prev)) {
+			cap->__prevmatch = match;
+			return i;
+		}
+		prev = match;
+	}
+	cap->__prevmatch = prev;
+	return -1;
+}
+
+
+void __sk_lacap_dma_callback(void)
+{
+	struct sk_lacap *cap = active_cap;
+	uint16_t from, to;
+
+	// Stream may be left with interrupts enabled by someone else (i.e. PWM sequence on TIM1)
+	if ((NULL == cap) || !cap->__isrunning || !cap->__istrigused) {
+		dma_clear_interrupt_flags(LACAP_DMA, LACAP_STREAM, DMA_HTIF | DMA_TCIF);
+		return;
+	}
+
+	if (dma_get_interrupt_flag(LACAP_DMA, LACAP_STREAM, DMA_HTIF)) {
+		dma_clear_interrupt_flags(LACAP_DMA, LACAP_STREAM, DMA_HTIF);
+		from = 0;
+		to = cap->len / 2;
+	} else if (dma_get_interrupt_flag(LACAP_DMA, LACAP_STREAM, DMA_TCIF)) {
+		dma_clear_interrupt_flags(LACAP_DMA, LACAP_STREAM, DMA_TCIF);
+		from = cap->len / 2;
+		to = cap->len;
+	} else {
+		return;
+	}
+
+	if (cap->__trigidx < 0) {
+		int32_t idx = lacap_scan(cap, from, to);
+		if (idx < 0)
+			return;
+		cap->__trigidx = idx;
+		// samples following the trigger in this half are already captured
+		cap->__postleft -= to - idx - 1;
+	} else {
+		cap->__postleft -= to - from;
+	}
+
+	if (cap->__postleft <= 0)
+		sk_lacap_stop(cap);
+}
+
+
+// DMA2 Stream 5 default ISR. May be overriden by user.
+void sk_attr_weak dma2_stream5_isr(void)
+{
+	__sk_lacap_dma_callback();
+}
+
+
+// VCD export
+
+static void out_str(sk_lacap_out_func_t out, void *arg, const char *str)
+{
+	while ('\0' != *str)
+		out(*str++, arg);
+}
+
+
+static void out_u64(sk_lacap_out_func_t out, void *arg, uint64_t val)
+{
+	char tmp[21];	// 2^64 has 20 decimal digits
+	int i = 0;
+	do {
+		tmp[i++] = '0' + (val % 10);
+		val /= 10;
+	} while (val);
+	while (i--)
+		out(tmp[i], arg);
+}
+
+
+/** VCD identifier of pin. Printable chars starting from '!' are used (private) */
+static inline char vcd_id(int pin)
+{
+	return '!' + pin;
+}
+
+
+static void out_value(sk_lacap_out_func_t out, void *arg, int pin, bool value)
+{
+	out(value ? '1' : '0', arg);
+	out(vcd_id(pin), arg);
+	out('\n', arg);
+}
+
+
+sk_err sk_lacap_export_vcd(const struct sk_lacap *cap, uint16_t pins, const char *const *names,
+						   sk_lacap_out_func_t out, void *arg)
+{
+	if ((NULL == cap) || (NULL == out) || (0 == pins))
+		return SK_EWRONGARG;
+	if (cap->__isrunning)
+		return SK_EUNAVAILABLE;
+
+	out_str(out, arg, "$timescale 1ns $end\n");
+	int32_t trig = sk_lacap_get_trigger(cap);
+	if (trig >= 0) {
+		out_str(out, arg, "$comment trigger at ");
+		out_u64(out, arg, (uint64_t)trig * 1000000000ull / cap->rate_hz);
+		out_str(out, arg, " ns $end\n");
+	}
+	out_str(out, arg, "$scope module gpio $end\n");
+	for (int i = 0; i < 16; i++) {
+		if (!(pins & (1 << i)))
+			continue;
+		out_str(out, arg, "$var wire 1 ");
+		out(vcd_id(i), arg);
+		out(' ', arg);
+		if ((NULL != names) && (NULL != names[i])) {
+			out_str(out, arg, names[i]);
+		} else {
+			out('P', arg);
+			out('A' + cap->port, arg);
+			out_u64(out, arg, i);
+		}
+		out_str(out, arg, " $end\n");
+	}
+	out_str(out, arg, "$upscope $end\n$enddefinitions $end\n");
+
+	// Initial values, then only changes
+	uint16_t prev = sk_lacap_get_sample(cap, 0);
+	out_str(out, arg, "#0\n$dumpvars\n");
+	for (int i = 0; i < 16; i++) {
+		if (pins & (1 << i))
+			out_value(out, arg, i, prev & (1 << i));
+	}
+	out_str(out, arg, "$end\n");
+
+	for (uint32_t n = 1; n < cap->len; n++) {
+		uint16_t cur = sk_lacap_get_sample(cap, n);
+		uint16_t changed = (cur ^ prev) & pins;
+		prev = cur;
+		if (!changed)
+			continue;
+		out('#', arg);
+		out_u64(out, arg, (uint64_t)n * 1000000000ull / cap->rate_hz);
+		out('\n', arg);
+		for (int i = 0; i < 16; i++) {
+			if (changed & (1 << i))
+				out_value(out, arg, i, cur & (1 << i));
+		}
+	}
+	return SK_EOK;
+}
@@ -1,4 +1,5 @@
 #include "lcd_hd44780.h"
+#include "delay.h"
 #include <stddef.h>
 
 
@@ -56,12 +57,73 @@ static void lcd_delay_us(struct sk_lcd *lcd, uint32_t us)
 
 
 
+// Pin accessors used in bit-bang. With SK_USE_LCD_STATIC_PINS they compile to constant stores
+// to GL-SK LCD pins, otherwise pins from lcd object are used
+#if SK_USE_LCD_STATIC_PINS
+#if !(SK_USE_GLSK_DEFINITIONS)
+#error "SK_USE_LCD_STATIC_PINS requires SK_USE_GLSK_DEFINITIONS"
+#endif
+
+static inline sk_attr_alwaysinline void lcd_pin_en_set(struct sk_lcd *lcd, bool value)
+{
+	(void)lcd;
+	sk_sio_lcd_en_set(value);
+}
+
+
+static inline sk_attr_alwaysinline void lcd_pin_rs_set(struct sk_lcd *lcd, bool value)
+{
+	(void)lcd;
+	sk_sio_lcd_rs_set(value);
+}
+
+
+static inline sk_attr_alwaysinline void lcd_pin_rw_set(struct sk_lcd *lcd, bool value)
+{
+	(void)lcd;
+	sk_sio_lcd_rw_set(value);
+}
+
+
+static inline sk_attr_alwaysinline void lcd_data_set(struct sk_lcd *lcd, uint16_t values)
+{
+	(void)lcd;
+	sk_sio_lcd_data_set(values);
+}
+
+#else
+
+static inline sk_attr_alwaysinline void lcd_pin_en_set(struct sk_lcd *lcd, bool value)
+{
+	sk_pin_set(*lcd->pin_en, value);
+}
+
+
+static inline sk_attr_alwaysinline void lcd_pin_rs_set(struct sk_lcd *lcd, bool value)
+{
+	sk_pin_set(*lcd->pin_rs, value);
+}
+
+
+static inline sk_attr_alwaysinline void lcd_pin_rw_set(struct sk_lcd *lcd, bool value)
+{
+	sk_pin_set(*lcd->pin_rw, value);
+}
+
+
+static inline sk_attr_alwaysinline void lcd_data_set(struct sk_lcd *lcd, uint16_t values)
+{
+	sk_pin_group_set(*lcd->pin_group_data, values);
+}
+#endif
+
+
 static void lcd_data_set_halfbyte(struct sk_lcd *lcd, uint8_t half)
 {
-	sk_pin_set(*lcd->pin_en, true);
-	sk_pin_group_set(*lcd->pin_group_data, half & 0x0F);
+	lcd_pin_en_set(lcd, true);
+	lcd_data_set(lcd, half & 0x0F);
 	lcd_delay_us(lcd, DELAY_ENA_STROBE_US);
-	sk_pin_set(*lcd->pin_en, false);
+	lcd_pin_en_set(lcd, false);
 	lcd_delay_us(lcd, DELAY_ENA_STROBE_US);
 }
 
@@ -81,8 +143,8 @@ static void lcd_data_set_byte(struct sk_lcd *lcd, uint8_t byte)
 
 static inline sk_err lcd_rsrw_set(struct sk_lcd *lcd, bool rs, bool rw)
 {
-	sk_pin_set(*lcd->pin_rs, rs);
-	sk_pin_set(*lcd->pin_rw, rw);
+	lcd_pin_rs_set(lcd, rs);
+	lcd_pin_rw_set(lcd, rw);
 }
 
 
@@ -204,7 +266,7 @@ void sk_lcd_putchar(struct sk_lcd *lcd, const char ch)
 
 static void lcd_init_4bit(struct sk_lcd *lcd)
 {
-	sk_pin_group_set(*lcd->pin_group_data, 0x00);
+	lcd_data_set(lcd, 0x00);
 
 	lcd_rsrw_set(lcd, 0, 0);
 	lcd_data_set_halfbyte(lcd, 0b0011);
@@ -260,9 +322,9 @@ sk_err sk_lcd_init(struct sk_lcd *lcd)
 	if ((NULL == lcd->pin_group_data) || (NULL == lcd->pin_rs) || (NULL == lcd->pin_en))
 		return SK_ENENARG;
 
-	// at least one of the functions must be used
-	if ((NULL == lcd->delay_func_us) && (NULL == lcd->delay_func_ms))
-		return SK_ENENARG;
+	// DWT-based delay is always available, so use it by default
+	if (NULL == lcd->delay_func_us)
+		lcd->delay_func_us = &sk_delay_us;
 
 	// *TODO* currently we only support 4-bit interface
 	if (! lcd->is4bitinterface)
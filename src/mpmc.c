@@ -0,0 +1,104 @@
+/**
+ * libsk lock-free bounded multi-producer multi-consumer queue
+ */
+
+#include "mpmc.h"
+#include "intrinsics.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+
+// Slot sequence protocol. For slot at position pos (index pos & mask):
+//  seq == pos             slot is free and may be claimed by put of pos
+//  seq == pos + 1         slot holds element and may be claimed by get of pos
+//  seq == pos + mask + 1  slot was released by get and is free for the next lap
+// Only the context which claimed position writes slot data and sequence
+
+
+sk_err sk_mpmc_init(sk_mpmc *q, void *buf, uint32_t *seq, uint32_t len, uint16_t elsize)
+{
+	if ((NULL == q) || (NULL == buf) || (NULL == seq) || (len < 2) || (len & (len - 1)) ||
+		(len > 0x80000000ul) || (0 == elsize))
+		return SK_EWRONGARG;
+
+	for (uint32_t i = 0; i < len; i++)
+		seq[i] = i;
+
+	q->buf = buf;
+	q->__seq = seq;
+	q->__mask = len - 1;
+	q->elsize = elsize;
+	q->__head = 0;
+	q->__tail = 0;
+	__DMB();	// publish initialized slots before queue is used
+	return SK_EOK;
+}
+
+
+/**
+ * Claim position in queue (private)
+ * @pos: head or tail of queue
+ * @seq: sequence array
+ * @mask: slot index mask
+ * @lag: difference between slot sequence and position when slot is ready (0 for put, 1 for get)
+ * @return: claimed position. Result is only valid if `*isok` is set
+ *
+ * Claim fails instead of waiting when slot is not ready, i.e. queue is full (empty) or slot is
+ * being completed by a preempted context.
+ */
+static inline uint32_t mpmc_claim(volatile uint32_t *pos, volatile uint32_t *seq, uint32_t mask,
+								  uint32_t lag, bool *isok)
+{
+	while (true) {
+		uint32_t p = __LDREXW(pos);
+		int32_t diff = (int32_t)(seq[p & mask] - (p + lag));
+		if (diff < 0) {
+			// slot was not released yet (for put) or not filled yet (for get)
+			__CLREX();
+			*isok = false;
+			return p;
+		}
+		if (diff > 0) {
+			// someone else claimed and completed this position after we have read it
+			__CLREX();
+			continue;
+		}
+		// fails when position was changed or exclusive monitor was cleared by interrupt
+		if (0 == __STREXW(p + 1, pos)) {
+			__DMB();	// slot contents are accessed only after it was claimed
+			*isok = true;
+			return p;
+		}
+	}
+}
+
+
+sk_err sk_mpmc_put(sk_mpmc *q, const void *el)
+{
+	bool isok;
+	uint32_t pos = mpmc_claim(&q->__head, q->__seq, q->__mask, 0, &isok);
+	if (!isok)
+		return SK_EFULL;
+
+	uint32_t idx = pos & q->__mask;
+	memcpy(&q->buf[idx * q->elsize], el, q->elsize);
+	__DMB();	// element must be in memory before slot is handed over to get
+	q->__seq[idx] = pos + 1;
+	return SK_EOK;
+}
+
+
+sk_err sk_mpmc_get(sk_mpmc *q, void *el)
+{
+	bool isok;
+	uint32_t pos = mpmc_claim(&q->__tail, q->__seq, q->__mask, 1, &isok);
+	if (!isok)
+		return SK_EEMPTY;
+
+	uint32_t idx = pos & q->__mask;
+	memcpy(el, &q->buf[idx * q->elsize], q->elsize);
+	__DMB();	// element must be read before slot is handed over to put of the next lap
+	q->__seq[idx] = pos + q->__mask + 1;
+	return SK_EOK;
+}
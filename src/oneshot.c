@@ -0,0 +1,201 @@
+/**
+ * libsk one-shot delay service
+ */
+
+#include "oneshot.h"
+#include "delay.h"
+#include "intrinsics.h"
+#include "tim.h"
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/timer.h>
+#include <stddef.h>
+
+
+#define ONESHOT_TIM		TIM7
+#define ONESHOT_IRQ		NVIC_TIM7_IRQ
+#define ONESHOT_RCC		RCC_TIM7
+#define ONESHOT_RST		RST_TIM7
+
+
+// Pending one-shots sorted by deadline
+static struct sk_oneshot *head = NULL;
+// CPU cycles in one microsecond (timer tick), rounded up
+static uint32_t cycles_per_us = 0;
+
+
+/**
+ * Make timer fire at the earliest deadline. Interrupts must be masked (private)
+ *
+ * When the earliest deadline is too far, timer fires at its maximum period and is
+ * reprogrammed again from ISR.
+ */
+static void oneshot_program(void)
+{
+	timer_disable_counter(ONESHOT_TIM);
+	timer_clear_flag(ONESHOT_TIM, TIM_SR_UIF);
+	if (NULL == head)
+		return;
+
+	int32_t left = head->__deadline - sk_cycles_get_current();
+	uint32_t us = (left > 0) ? ((uint32_t)left + cycles_per_us - 1) / cycles_per_us : 0;
+	// counter is blocked with ARR == 0, so 2 us is the shortest period
+	if (us < 2)
+		us = 2;
+	if (us > 0x10000)
+		us = 0x10000;
+
+	timer_set_period(ONESHOT_TIM, us - 1);
+	timer_set_counter(ONESHOT_TIM, 0);
+	timer_enable_counter(ONESHOT_TIM);	// one-pulse mode clears CEN on update
+}
+
+
+/** Remove one-shot from list. Interrupts must be masked (private) */
+static void oneshot_remove(struct sk_oneshot *os)
+{
+	for (struct sk_oneshot **pp = &head; NULL != *pp; pp = &(*pp)->__next) {
+		if (*pp == os) {
+			*pp = os->__next;
+			break;
+		}
+	}
+	os->__ispending = false;
+}
+
+
+sk_err sk_oneshot_init(uint8_t irq_priority)
+{
+	// timer ticks every microsecond
+	uint32_t clock = sk_tim_get_clock(ONESHOT_TIM);
+	uint32_t psc = clock / 1000000;
+	if ((0 == psc) || (psc > 0x10000))
+		return SK_ERANGE;
+
+	sk_delay_init();
+	cycles_per_us = (rcc_ahb_frequency + 999999) / 1000000;
+
+	rcc_periph_clock_enable(ONESHOT_RCC);
+	rcc_periph_reset_pulse(ONESHOT_RST);
+	timer_set_prescaler(ONESHOT_TIM, psc - 1);
+	timer_disable_preload(ONESHOT_TIM);		// ARR writes take effect immediately
+	timer_one_shot_mode(ONESHOT_TIM);
+	// Only overflow sets UIF, so UG below does not produce interrupt
+	timer_update_on_overflow(ONESHOT_TIM);
+	timer_generate_event(ONESHOT_TIM, TIM_EGR_UG);	// load prescaler
+	timer_clear_flag(ONESHOT_TIM, TIM_SR_UIF);
+	timer_enable_irq(ONESHOT_TIM, TIM_DIER_UIE);
+
+	nvic_set_priority(ONESHOT_IRQ, irq_priority);
+	nvic_enable_irq(ONESHOT_IRQ);
+
+	bool masked = cm_mask_interrupts(true);
+	oneshot_program();	// pick up one-shots left from previous init
+	cm_mask_interrupts(masked);
+	return SK_EOK;
+}
+
+
+sk_err sk_oneshot_start(struct sk_oneshot *os, uint32_t us)
+{
+	if ((NULL == os) || (NULL == os->func) || (0 == cycles_per_us))
+		return SK_EWRONGARG;
+	if ((uint64_t)us * cycles_per_us >= 0x80000000ull)
+		return SK_ERANGE;
+
+	bool masked = cm_mask_interrupts(true);
+	if (os->__ispending)
+		oneshot_remove(os);
+
+	os->__deadline = sk_cycles_get_current() + us * cycles_per_us;
+	// Insert after all one-shots with earlier or the same deadline, so that equal deadlines
+	// fire in order of start
+	struct sk_oneshot **pp = &head;
+	while ((NULL != *pp) && ((int32_t)((*pp)->__deadline - os->__deadline) <= 0))
+		pp = &(*pp)->__next;
+	os->__next = *pp;
+	*pp = os;
+	os->__ispending = true;
+
+	// Timer only needs reprogramming when the earliest deadline changes
+	if (head == os)
+		oneshot_program();
+	cm_mask_interrupts(masked);
+	return SK_EOK;
+}
+
+
+void sk_oneshot_cancel(struct sk_oneshot *os)
+{
+	if ((NULL == os) || !os->__ispending)
+		return;
+
+	bool masked = cm_mask_interrupts(true);
+	bool wasfirst = (head == os);
+	oneshot_remove(os);
+	if (wasfirst)
+		oneshot_program();
+	cm_mask_interrupts(masked);
+}
+
+
+/** Completion callback of :c:func:`sk_oneshot_delay_us` (private) */
+static void oneshot_delay_done(struct sk_oneshot *os, void *arg)
+{
+	(void)os;
+	*(volatile bool *)arg = true;
+}
+
+
+void sk_oneshot_delay_us(uint32_t us)
+{
+	volatile bool isdone = false;
+	struct sk_oneshot os = { .func = &oneshot_delay_done, .arg = (void *)&isdone };
+	if (SK_EOK != sk_oneshot_start(&os, us))
+		return;
+
+	// Check and sleep with interrupts masked, so that completion can not slip in between.
+	// Pending interrupt wakes the core up and is taken once interrupts are unmasked
+	while (true) {
+		bool masked = cm_mask_interrupts(true);
+		if (!isdone)
+			__WFI();
+		cm_mask_interrupts(masked);
+		if (isdone)
+			break;
+	}
+}
+
+
+void __sk_oneshot_callback(void)
+{
+	if (!timer_get_flag(ONESHOT_TIM, TIM_SR_UIF))
+		return;
+	timer_clear_flag(ONESHOT_TIM, TIM_SR_UIF);
+
+	while (true) {
+		bool masked = cm_mask_interrupts(true);
+		struct sk_oneshot *os = head;
+		// Deadlines within one timer tick are due, as timer can not resolve them anyway
+		if ((NULL == os) ||
+			((int32_t)(os->__deadline - sk_cycles_get_current()) >= (int32_t)cycles_per_us)) {
+			oneshot_program();
+			cm_mask_interrupts(masked);
+			break;
+		}
+		head = os->__next;
+		os->__ispending = false;
+		cm_mask_interrupts(masked);
+
+		// callback may start or cancel any one-shot, including this one
+		os->func(os, os->arg);
+	}
+}
+
+
+// TIM7 default ISR. May be overriden by user.
+void sk_attr_weak tim7_isr(void)
+{
+	__sk_oneshot_callback();
+}
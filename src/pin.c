@@ -1,5 +1,111 @@
 #include "pin.h"
 #include <libopencm3/stm32/rcc.h>
+#include <stddef.h>
+
+#if !(SK_USE_SIZE_OPTIMIZATIONS)
+// Table-driven densify/sparsify. 16-bit port value is processed as 4 nibbles.
+// For every nibble the result is looked up in a 16x16 table indexed by [mask][value] and
+// shifted by the number of mask bits in lower nibbles. This way we have no data-dependent
+// branches and a fixed number of operations regardless of the mask.
+// Both variants are checked against each other in tests/host/pin_nibble.c
+
+/** Number of bits set in a nibble (private) */
+static const uint8_t nibble_popcnt[16] = {
+	0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+
+/**
+ * Densified nibbles (private)
+ * nibble_densify[mask][sparse] holds bits of sparse selected by mask, moved to lowest positions
+ */
+static const uint8_t nibble_densify[16][16] = {
+	{ 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0 },	// mask 0x0
+	{ 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1 },	// mask 0x1
+	{ 0x0, 0x0, 0x1, 0x1, 0x0, 0x0, 0x1, 0x1, 0x0, 0x0, 0x1, 0x1, 0x0, 0x0, 0x1, 0x1 },	// mask 0x2
+	{ 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3 },	// mask 0x3
+	{ 0x0, 0x0, 0x0, 0x0, 0x1, 0x1, 0x1, 0x1, 0x0, 0x0, 0x0, 0x0, 0x1, 0x1, 0x1, 0x1 },	// mask 0x4
+	{ 0x0, 0x1, 0x0, 0x1, 0x2, 0x3, 0x2, 0x3, 0x0, 0x1, 0x0, 0x1, 0x2, 0x3, 0x2, 0x3 },	// mask 0x5
+	{ 0x0, 0x0, 0x1, 0x1, 0x2, 0x2, 0x3, 0x3, 0x0, 0x0, 0x1, 0x1, 0x2, 0x2, 0x3, 0x3 },	// mask 0x6
+	{ 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7 },	// mask 0x7
+	{ 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x1, 0x1, 0x1, 0x1, 0x1, 0x1, 0x1, 0x1 },	// mask 0x8
+	{ 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x2, 0x3, 0x2, 0x3, 0x2, 0x3, 0x2, 0x3 },	// mask 0x9
+	{ 0x0, 0x0, 0x1, 0x1, 0x0, 0x0, 0x1, 0x1, 0x2, 0x2, 0x3, 0x3, 0x2, 0x2, 0x3, 0x3 },	// mask 0xA
+	{ 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x4, 0x5, 0x6, 0x7 },	// mask 0xB
+	{ 0x0, 0x0, 0x0, 0x0, 0x1, 0x1, 0x1, 0x1, 0x2, 0x2, 0x2, 0x2, 0x3, 0x3, 0x3, 0x3 },	// mask 0xC
+	{ 0x0, 0x1, 0x0, 0x1, 0x2, 0x3, 0x2, 0x3, 0x4, 0x5, 0x4, 0x5, 0x6, 0x7, 0x6, 0x7 },	// mask 0xD
+	{ 0x0, 0x0, 0x1, 0x1, 0x2, 0x2, 0x3, 0x3, 0x4, 0x4, 0x5, 0x5, 0x6, 0x6, 0x7, 0x7 },	// mask 0xE
+	{ 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0xA, 0xB, 0xC, 0xD, 0xE, 0xF },	// mask 0xF
+};
+
+
+/**
+ * Sparsified nibbles (private)
+ * nibble_sparsify[mask][dense] holds lowest bits of dense, moved to positions set in mask
+ */
+static const uint8_t nibble_sparsify[16][16] = {
+	{ 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0 },	// mask 0x0
+	{ 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1 },	// mask 0x1
+	{ 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2 },	// mask 0x2
+	{ 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3 },	// mask 0x3
+	{ 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4 },	// mask 0x4
+	{ 0x0, 0x1, 0x4, 0x5, 0x0, 0x1, 0x4, 0x5, 0x0, 0x1, 0x4, 0x5, 0x0, 0x1, 0x4, 0x5 },	// mask 0x5
+	{ 0x0, 0x2, 0x4, 0x6, 0x0, 0x2, 0x4, 0x6, 0x0, 0x2, 0x4, 0x6, 0x0, 0x2, 0x4, 0x6 },	// mask 0x6
+	{ 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7 },	// mask 0x7
+	{ 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8 },	// mask 0x8
+	{ 0x0, 0x1, 0x8, 0x9, 0x0, 0x1, 0x8, 0x9, 0x0, 0x1, 0x8, 0x9, 0x0, 0x1, 0x8, 0x9 },	// mask 0x9
+	{ 0x0, 0x2, 0x8, 0xA, 0x0, 0x2, 0x8, 0xA, 0x0, 0x2, 0x8, 0xA, 0x0, 0x2, 0x8, 0xA },	// mask 0xA
+	{ 0x0, 0x1, 0x2, 0x3, 0x8, 0x9, 0xA, 0xB, 0x0, 0x1, 0x2, 0x3, 0x8, 0x9, 0xA, 0xB },	// mask 0xB
+	{ 0x0, 0x4, 0x8, 0xC, 0x0, 0x4, 0x8, 0xC, 0x0, 0x4, 0x8, 0xC, 0x0, 0x4, 0x8, 0xC },	// mask 0xC
+	{ 0x0, 0x1, 0x4, 0x5, 0x8, 0x9, 0xC, 0xD, 0x0, 0x1, 0x4, 0x5, 0x8, 0x9, 0xC, 0xD },	// mask 0xD
+	{ 0x0, 0x2, 0x4, 0x6, 0x8, 0xA, 0xC, 0xE, 0x0, 0x2, 0x4, 0x6, 0x8, 0xA, 0xC, 0xE },	// mask 0xE
+	{ 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0xA, 0xB, 0xC, 0xD, 0xE, 0xF },	// mask 0xF
+};
+
+
+/**
+ * Densification helper (private)
+ * Example:
+ *     mask = 0b1010000011110010
+ *   sparse = 0b1010101010101010
+ *   result = 0b1 1     1010  1
+ */
+static inline uint16_t group_densify(uint16_t mask, uint16_t sparse)
+{
+	uint32_t ret = 0;
+	uint32_t idx = 0;
+	// constant trip count -- the only branch is the loop itself, which compiler may unroll
+	for (int i = 0; i < 16; i += 4) {
+		uint32_t m = (mask >> i) & 0xF;
+		ret |= (uint32_t)nibble_densify[m][(sparse >> i) & 0xF] << idx;
+		idx += nibble_popcnt[m];
+	}
+	return ret;
+}
+
+
+/**
+ * Sparsification helper (private)
+ * Example:
+ *     mask = 0b1010000011110010
+ *    dense = 0b1 1     1010  1
+ *   result = 0b1010000010100010
+ */
+static inline uint16_t group_sparsify(uint16_t mask, uint16_t dense)
+{
+	uint32_t ret = 0;
+	uint32_t idx = 0;
+	for (int i = 0; i < 16; i += 4) {
+		uint32_t m = (mask >> i) & 0xF;
+		// table ignores dense bits above popcount(m), so they need not be masked out here
+		ret |= (uint32_t)nibble_sparsify[m][(dense >> idx) & 0xF] << i;
+		idx += nibble_popcnt[m];
+	}
+	return ret;
+}
+
+#else
+// Size-optimized variants. Loop over every bit instead of using 0.5K of lookup tables
 
 /**
  * Densification helper (private)
@@ -41,6 +147,7 @@ static uint16_t group_sparsify(uint16_t mask, uint16_t dense)
 	}
 	return ret;
 }
+#endif
 
 
 bool sk_pin_read(sk_pin pin)
@@ -75,27 +182,191 @@ uint16_t sk_pin_group_read(sk_pin_group group)
 
 void sk_pin_group_set(sk_pin_group group, uint16_t values)
 {
-	// We want to change only pins we use in group, and don't touch the others
-	// We also want to manipulate the output register, not what's on port input at the moment,
-    // so gpio_port_read() does not suit. Use GPIO ODR register directly
-	values = group_sparsify(group.pins, values);
-	values ^= group.inversions;
-	volatile uint32_t *odr = &GPIO_ODR(sk_pin_port_to_gpio(group.port));
-	uint32_t pval = *odr;
-	pval &= ~((uint32_t)(group.pins));	// reset all pins in account
-	pval |= values;			// set all pins in account to our values
-	*odr = pval;
+	// We want to change only pins we use in group, and don't touch the others.
+	// Instead of read-modify-write of ODR, use BSRR register: its lower half sets pins and
+	// higher half resets them. This way group is written with one store, which is atomic
+	// with respect to ISRs touching other pins of the same port
+	uint32_t sparse = group_sparsify(group.pins, values) ^ group.inversions;
+	uint32_t set = sparse & group.pins;
+	uint32_t reset = ~sparse & group.pins;
+	GPIO_BSRR(sk_pin_port_to_gpio(group.port)) = set | (reset << 16);
 }
 
 
 void sk_pin_group_toggle(sk_pin_group group, uint16_t values)
 {
-	values = group_sparsify(group.pins, values);
-	volatile uint32_t *odr = &GPIO_ODR(sk_pin_port_to_gpio(group.port));
-	*odr ^= values;
+	// Same approach as libopencm3 gpio_toggle(). ODR is only read here, the write goes to BSRR.
+	// So concurrent writes to other pins of the same port can not be lost
+	uint32_t port = sk_pin_port_to_gpio(group.port);
+	uint32_t tgl = group_sparsify(group.pins, values);
+	uint32_t odr = GPIO_ODR(port);
+	GPIO_BSRR(port) = (tgl & ~odr) | ((tgl & odr) << 16);
 }
 
 
+/**
+ * Put BSRR word for masked pins into accumulated one (private)
+ * Previous changes of the same pins are dropped. Otherwise BSRR set half would win over reset
+ */
+static inline void txn_merge(sk_pin_txn *txn, uint8_t port, uint16_t pins, uint16_t sparse)
+{
+	uint32_t set = sparse & pins;
+	uint32_t reset = ~sparse & pins;
+	uint32_t both = ((uint32_t)pins << 16) | pins;
+	uint32_t prev = (txn->__ports & (1 << port)) ? txn->__bsrr[port] : 0;
+	txn->__bsrr[port] = (prev & ~both) | set | (reset << 16);
+	txn->__ports |= (1 << port);
+}
+
+
+void sk_pin_txn_set(sk_pin_txn *txn, sk_pin pin, bool value)
+{
+	uint16_t mask = (1 << pin.pin);
+	txn_merge(txn, pin.port, mask, (value ^ pin.isinverse) ? mask : 0);
+}
+
+
+void sk_pin_txn_group_set(sk_pin_txn *txn, sk_pin_group group, uint16_t values)
+{
+	uint16_t sparse = group_sparsify(group.pins, values) ^ group.inversions;
+	txn_merge(txn, group.port, group.pins, sparse);
+}
+
+
+void sk_pin_txn_commit(const sk_pin_txn *txn)
+{
+	// Values are prepared in memory beforehand, so that stores to consecutive ports
+	// are only separated by a few instructions
+	uint16_t ports = txn->__ports;
+	for (uint32_t p = SK_PORTA; ports; p++, ports >>= 1) {
+		if (ports & 1)
+			GPIO_BSRR(sk_pin_port_to_gpio(p)) = txn->__bsrr[p];
+	}
+}
+
+
+void sk_pin_snapshot_take(sk_pin_snapshot *snap, uint16_t ports)
+{
+	for (uint32_t p = SK_PORTA; ports && (p < SK_PORT_COUNT); p++, ports >>= 1) {
+		if (ports & 1)
+			snap->__idr[p] = GPIO_IDR(sk_pin_port_to_gpio(p));
+	}
+}
+
+
+bool sk_pin_snapshot_read(const sk_pin_snapshot *snap, sk_pin pin)
+{
+	bool ret = snap->__idr[pin.port] & (1 << pin.pin);
+	return ret ^ pin.isinverse;
+}
+
+
+uint16_t sk_pin_snapshot_group_read(const sk_pin_snapshot *snap, sk_pin_group group)
+{
+	uint16_t val = snap->__idr[group.port] ^ group.inversions;
+	return group_densify(group.pins, val);
+}
+
+
+/**
+ * Fold per-pin field value into register image (private)
+ * @reg: accumulated register value
+ * @regmask: accumulated mask of register bits to be written
+ * @pins: 16-bit pin mask
+ * @width: field width in bits per pin
+ * @val: field value
+ *
+ * Only handles up to 8 pins for 4-bit fields, so AFR is processed as two 8-pin halves
+ */
+static void cfg_fold_field(uint32_t *reg, uint32_t *regmask, uint16_t pins,
+						   uint32_t width, uint32_t val)
+{
+	uint32_t fmask = (1ul << width) - 1;
+	for (uint32_t i = 0; i < 16; i++) {
+		if (!(pins & (1 << i)))
+			continue;
+		uint32_t shift = i * width;
+		*regmask |= fmask << shift;
+		*reg = (*reg & ~(fmask << shift)) | ((val & fmask) << shift);
+	}
+}
+
+
+/** Write only masked bits of a register (private) */
+static inline void cfg_reg_write(volatile uint32_t *reg, uint32_t val, uint32_t mask)
+{
+	if (mask)
+		*reg = (*reg & ~mask) | (val & mask);
+}
+
+
+sk_err sk_pin_cfg_apply(const struct sk_pin_cfg *cfg, uint32_t len)
+{
+	if ((NULL == cfg) && len)
+		return SK_EWRONGARG;
+
+	// First pass: validate and collect ports which need their clocks enabled
+	uint32_t rccmask = 0;
+	for (uint32_t i = 0; i < len; i++) {
+		if (cfg[i].port >= SK_PORT_COUNT)
+			return SK_EWRONGARG;
+		if (cfg[i].pins)
+			rccmask |= 1ul << cfg[i].port;	// GPIOxEN bits in AHB1ENR follow port order
+	}
+
+	if (!rccmask)
+		return SK_EOK;
+
+	RCC_AHB1ENR |= rccmask;
+	// Dummy read back. Provides the delay required after enabling peripheral clock
+	// (see "Delay after an RCC peripheral clock enabling" in Errata)
+	(void)RCC_AHB1ENR;
+
+	// Second pass: fold entries into register images for each port and write them at once
+	for (uint32_t p = SK_PORTA; p < SK_PORT_COUNT; p++) {
+		if (!(rccmask & (1ul << p)))
+			continue;
+
+		uint32_t moder = 0, moder_m = 0, pupdr = 0, pupdr_m = 0;
+		uint32_t otyper = 0, otyper_m = 0, ospeedr = 0, ospeedr_m = 0;
+		uint32_t afrl = 0, afrl_m = 0, afrh = 0, afrh_m = 0;
+		uint32_t bsrr = 0;
+
+		for (uint32_t i = 0; i < len; i++) {
+			const struct sk_pin_cfg *c = &cfg[i];
+			if (c->port != p)
+				continue;
+
+			cfg_fold_field(&moder, &moder_m, c->pins, 2, c->mode);
+			cfg_fold_field(&pupdr, &pupdr_m, c->pins, 2, c->pupd);
+			cfg_fold_field(&otyper, &otyper_m, c->pins, 1, c->otype);
+			cfg_fold_field(&ospeedr, &ospeedr_m, c->pins, 2, c->ospeed);
+			cfg_fold_field(&afrl, &afrl_m, c->pins & 0x00FF, 4, c->af);
+			cfg_fold_field(&afrh, &afrh_m, c->pins >> 8, 4, c->af);
+
+			// Output level as BSRR image. Later entries override earlier ones
+			uint32_t level = (c->outval ? c->pins : 0) ^ (c->inversions & c->pins);
+			bsrr &= ~(((uint32_t)c->pins << 16) | c->pins);
+			bsrr |= (level & c->pins) | ((~level & c->pins) << 16);
+		}
+
+		uint32_t port = sk_pin_port_to_gpio(p);
+		cfg_reg_write(&GPIO_OTYPER(port), otyper, otyper_m);
+		cfg_reg_write(&GPIO_OSPEEDR(port), ospeedr, ospeedr_m);
+		cfg_reg_write(&GPIO_PUPDR(port), pupdr, pupdr_m);
+		cfg_reg_write(&GPIO_AFRL(port), afrl, afrl_m);
+		cfg_reg_write(&GPIO_AFRH(port), afrh, afrh_m);
+		if (bsrr)
+			GPIO_BSRR(port) = bsrr;
+		// Mode is the last, so pins become outputs with proper level and options already set
+		cfg_reg_write(&GPIO_MODER(port), moder, moder_m);
+	}
+
+	return SK_EOK;
+}
+
+
+
 #if defined(SK_USE_GLSK_DEFINITIONS) && SK_USE_GLSK_DEFINITIONS
 // some STM32F4DISCOVERY pins
 const sk_pin sk_io_led_orange 	= { .port=SK_PORTD, .pin=13, .isinverse=false };
@@ -125,70 +396,46 @@ const sk_pin_group sk_io_lcd_data = {
 
 #if !(SK_USE_SIZE_OPTIMIZATIONS)
 
-static inline void rcc_set_state(enum sk_port portnum, bool state)
-{
-	uint32_t rccunit = (0x30 << 5) | portnum;
-	if (state)
-		rcc_periph_clock_enable(rccunit);
-	else
-		rcc_periph_clock_disable(rccunit);
-}
-
-
 void glsk_pins_init(const bool set_all)
 {
-
-	// Initialize all pins to analog, low-speed, af0, push-pull, no-pullup
-	// Analog mode will allow for lower power consumption
-	for (int i = SK_PORTA; set_all && (i <= SK_PORTH); i++) {
-		rcc_set_state(i, true);
-		uint32_t port = sk_pin_port_to_gpio(i);
-		gpio_mode_setup(port, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, 0xffff);
-		gpio_set_output_options(port, GPIO_OTYPE_PP, GPIO_OSPEED_2MHZ, 0xffff);
-		gpio_set_af(port, 0, 0xffff);
-		rcc_set_state(i, false);
-	}
-
-	sk_pin out_pins[] = {
-		sk_io_led_orange,
-		sk_io_led_red,
-		sk_io_led_green,
-		sk_io_led_blue,
-		sk_io_eth_led,
-		sk_io_lcd_bkl,
-		sk_io_lcd_rs,
-		sk_io_lcd_rw,
-		sk_io_lcd_en,
-		sk_io_spiflash_ce
-	};
-
-	// set all outputs to out, push-pull, no pullup
-	sk_arr_foreach(pin, out_pins) {
-		rcc_set_state(pin.port, true);
-		uint32_t port = sk_pin_port_to_gpio(pin.port);
-		gpio_mode_setup(port, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, (1 << pin.pin));
-		sk_pin_set(pin, false);
+	if (set_all) {
+		// Initialize all pins to analog, low-speed, af0, push-pull, no-pullup
+		// Analog mode will allow for lower power consumption
+		struct sk_pin_cfg analog[SK_PORTH + 1];
+		for (int i = SK_PORTA; i <= SK_PORTH; i++) {
+			analog[i] = (struct sk_pin_cfg){
+				.port = i, .pins = 0xffff,
+				.mode = GPIO_MODE_ANALOG, .pupd = GPIO_PUPD_NONE,
+				.otype = GPIO_OTYPE_PP, .ospeed = GPIO_OSPEED_2MHZ, .af = 0
+			};
+		}
+		sk_pin_cfg_apply(analog, sk_arr_len(analog));
+		// Clocks are left enabled only for ports used below
+		RCC_AHB1ENR &= ~((1ul << (SK_PORTH + 1)) - 1);
 	}
 
-	rcc_set_state(sk_io_lcd_data.port, true);
-	gpio_mode_setup(sk_pin_port_to_gpio(sk_io_lcd_data.port), GPIO_MODE_OUTPUT,
-				    GPIO_PUPD_NONE, sk_io_lcd_data.pins);
-
-	sk_pin in_pins[] = {
-		sk_io_btn_usr,
-		sk_io_btn_right,
-		sk_io_btn_left,
-		sk_io_btn_mid,
-		sk_io_btn_up,
-		sk_io_btn_down
+	// Outputs: out, push-pull, no pullup, inactive level. Inputs: in, no pullup
+	const struct sk_pin_cfg pins[] = {
+		{ SK_PIN_CFG_PIN(sk_io_led_orange),  .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_led_red),     .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_led_green),   .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_led_blue),    .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_eth_led),     .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_lcd_bkl),     .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_lcd_rs),      .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_lcd_rw),      .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_lcd_en),      .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_spiflash_ce), .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_GROUP(sk_io_lcd_data),  .mode = GPIO_MODE_OUTPUT },
+		{ SK_PIN_CFG_PIN(sk_io_btn_usr),     .mode = GPIO_MODE_INPUT },
+		{ SK_PIN_CFG_PIN(sk_io_btn_right),   .mode = GPIO_MODE_INPUT },
+		{ SK_PIN_CFG_PIN(sk_io_btn_left),    .mode = GPIO_MODE_INPUT },
+		{ SK_PIN_CFG_PIN(sk_io_btn_mid),     .mode = GPIO_MODE_INPUT },
+		{ SK_PIN_CFG_PIN(sk_io_btn_up),      .mode = GPIO_MODE_INPUT },
+		{ SK_PIN_CFG_PIN(sk_io_btn_down),    .mode = GPIO_MODE_INPUT }
 	};
 
-	// set all inputs to in, no pullup
-	sk_arr_foreach(pin, in_pins) {
-		rcc_set_state(pin.port, true);
-		uint32_t port = sk_pin_port_to_gpio(pin.port);
-		gpio_mode_setup(port, GPIO_MODE_INPUT, GPIO_PUPD_NONE, (1 << pin.pin));
-	}
+	sk_pin_cfg_apply(pins, sk_arr_len(pins));
 }
 #endif
 #endif
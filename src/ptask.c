@@ -0,0 +1,144 @@
+/**
+ * libsk periodic tasks
+ */
+
+#include "ptask.h"
+#include "delay.h"
+#include "tick.h"
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/systick.h>
+#include <libopencm3/stm32/rcc.h>
+#include <stddef.h>
+
+
+void sk_ptask_reset_stats(struct sk_ptask *task)
+{
+	task->stats = (struct sk_ptask_stats){
+		.jitter_min = UINT32_MAX,
+		.exec_min = UINT32_MAX
+	};
+}
+
+
+void sk_ptask_get_stats(const struct sk_ptask *task, struct sk_ptask_stats *stats)
+{
+	*stats = task->stats;
+}
+
+
+sk_err sk_ptask_runner_init(struct sk_ptask_runner *runner, struct sk_ptask *tasks,
+							uint8_t ntasks)
+{
+	if ((NULL == runner) || (NULL == tasks) || (0 == ntasks) || (ntasks > SK_PTASK_MAXTASKS))
+		return SK_EWRONGARG;
+
+	for (uint8_t i = 0; i < ntasks; i++) {
+		if ((NULL == tasks[i].func) || (0 == tasks[i].period))
+			return SK_EWRONGARG;
+	}
+
+	runner->tasks = tasks;
+	runner->ntasks = ntasks;
+
+	// Rate-monotonic priority: shorter period first. Insertion sort keeps definition order
+	// for equal periods
+	for (uint8_t i = 0; i < ntasks; i++) {
+		uint8_t j = i;
+		while ((j > 0) && (tasks[runner->__order[j - 1]].period > tasks[i].period)) {
+			runner->__order[j] = runner->__order[j - 1];
+			j--;
+		}
+		runner->__order[j] = i;
+	}
+
+	sk_delay_init();
+	uint64_t now = sk_tick_get_current64();
+	for (uint8_t i = 0; i < ntasks; i++) {
+		if (0 == tasks[i].deadline)
+			tasks[i].deadline = tasks[i].period;
+		tasks[i].__release = now + 1 + tasks[i].phase;
+		sk_ptask_reset_stats(&tasks[i]);
+	}
+	return SK_EOK;
+}
+
+
+/** Run task and update its statistics (private) */
+static void ptask_run(struct sk_ptask *task)
+{
+	struct sk_ptask_stats *st = &task->stats;
+	uint64_t release = task->__release;
+
+	// Release moment in sk_time_now_raw() units is the tick boundary
+	uint32_t tickraw = systick_get_reload() + 1;
+	uint64_t releaseraw = release * tickraw;
+	// SysTick is clocked either from CPU clock or from CPU clock / 8
+	uint32_t rawcycles = rcc_ahb_frequency / sk_time_get_rate_hz();
+
+	uint32_t jitter = (sk_time_now_raw() - releaseraw) * rawcycles;
+	uint32_t start = sk_cycles_get_current();
+	task->func(task, task->arg);
+	uint32_t exec = sk_cycles_get_current() - start;
+	uint64_t endraw = sk_time_now_raw();
+
+	st->nruns++;
+	st->exec_total += exec;
+	if (exec < st->exec_min)
+		st->exec_min = exec;
+	if (exec > st->exec_max)
+		st->exec_max = exec;
+	if (jitter < st->jitter_min)
+		st->jitter_min = jitter;
+	if (jitter > st->jitter_max)
+		st->jitter_max = jitter;
+	if (endraw > releaseraw + (uint64_t)task->deadline * tickraw)
+		st->noverruns++;
+
+	// Next release is kept on the period grid. When task is late for more than a period,
+	// run it only once and drop the releases missed
+	uint64_t next = release + task->period;
+	uint64_t now = sk_tick_get_current64();
+	if (now >= next + task->period) {
+		uint64_t nmissed = (now - next) / task->period;
+		next += nmissed * task->period;
+		st->nskipped += nmissed;
+	}
+	task->__release = next;
+}
+
+
+bool sk_ptask_run_once(struct sk_ptask_runner *runner)
+{
+	uint64_t now = sk_tick_get_current64();
+	for (uint8_t i = 0; i < runner->ntasks; i++) {
+		struct sk_ptask *task = &runner->tasks[runner->__order[i]];
+		if (task->__release <= now) {
+			ptask_run(task);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void sk_ptask_run(struct sk_ptask_runner *runner)
+{
+	while (true) {
+		if (sk_ptask_run_once(runner))
+			continue;
+
+		// Find the nearest release and sleep till it
+		bool masked = cm_mask_interrupts(true);
+		uint64_t now = sk_tick_get_current64();
+		uint64_t nearest = UINT64_MAX;
+		for (uint8_t i = 0; i < runner->ntasks; i++) {
+			if (runner->tasks[i].__release < nearest)
+				nearest = runner->tasks[i].__release;
+		}
+		if (nearest > now) {
+			uint64_t wait = nearest - now;
+			sk_tick_idle((wait > UINT32_MAX) ? UINT32_MAX : (uint32_t)wait);
+		}
+		cm_mask_interrupts(masked);
+	}
+}
@@ -0,0 +1,292 @@
+/**
+ * libsk hardware PWM
+ */
+
+#include "pwm.h"
+#include "tim.h"
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/timer.h>
+#include <stddef.h>
+
+
+/** Timer resources (private) */
+struct pwm_tim {
+	uint32_t tim;
+	enum rcc_periph_clken rcc;
+	enum rcc_periph_rst rst;
+	uint8_t af;
+	bool is32bit;
+	/** Has break and dead-time register with main output enable and repetition counter */
+	bool isadvanced;
+	/** Update request DMA or 0 if there is none (or it is not usable for 16-bit sequences) */
+	uint32_t dma;
+	uint8_t stream;
+	uint8_t chsel;
+};
+
+
+enum pwm_tim_idx {
+	PWM_TIM1 = 0, PWM_TIM2, PWM_TIM3, PWM_TIM4, PWM_TIM5, PWM_TIM8,
+	PWM_TIM9, PWM_TIM10, PWM_TIM11, PWM_TIM12, PWM_TIM13, PWM_TIM14
+};
+
+
+// TIMx_UP requests (see p. 10.3.3 RM0090, Tables 42, 43). Halfword writes to 32-bit timers
+// are duplicated into both register halves by APB bridge, so TIM2, TIM5 sequences are not used
+static const struct pwm_tim pwm_tims[] = {
+	[PWM_TIM1]  = { TIM1,  RCC_TIM1,  RST_TIM1,  GPIO_AF1, false, true,  DMA2, DMA_STREAM5, 6 },
+	[PWM_TIM2]  = { TIM2,  RCC_TIM2,  RST_TIM2,  GPIO_AF1, true,  false, 0, 0, 0 },
+	[PWM_TIM3]  = { TIM3,  RCC_TIM3,  RST_TIM3,  GPIO_AF2, false, false, DMA1, DMA_STREAM2, 5 },
+	[PWM_TIM4]  = { TIM4,  RCC_TIM4,  RST_TIM4,  GPIO_AF2, false, false, DMA1, DMA_STREAM6, 2 },
+	[PWM_TIM5]  = { TIM5,  RCC_TIM5,  RST_TIM5,  GPIO_AF2, true,  false, 0, 0, 0 },
+	[PWM_TIM8]  = { TIM8,  RCC_TIM8,  RST_TIM8,  GPIO_AF3, false, true,  DMA2, DMA_STREAM1, 7 },
+	[PWM_TIM9]  = { TIM9,  RCC_TIM9,  RST_TIM9,  GPIO_AF3, false, false, 0, 0, 0 },
+	[PWM_TIM10] = { TIM10, RCC_TIM10, RST_TIM10, GPIO_AF3, false, false, 0, 0, 0 },
+	[PWM_TIM11] = { TIM11, RCC_TIM11, RST_TIM11, GPIO_AF3, false, false, 0, 0, 0 },
+	[PWM_TIM12] = { TIM12, RCC_TIM12, RST_TIM12, GPIO_AF9, false, false, 0, 0, 0 },
+	[PWM_TIM13] = { TIM13, RCC_TIM13, RST_TIM13, GPIO_AF9, false, false, 0, 0, 0 },
+	[PWM_TIM14] = { TIM14, RCC_TIM14, RST_TIM14, GPIO_AF9, false, false, 0, 0, 0 },
+};
+
+
+/** Pin to timer channel mapping entry (private) */
+struct pwm_pinmap {
+	uint8_t port;
+	uint8_t pin;
+	uint8_t timidx;
+	uint8_t channel;
+};
+
+
+// Main (non-complementary) timer outputs (see Table 9 "Alternate function mapping" in DS8626)
+static const struct pwm_pinmap pwm_pins[] = {
+	{ SK_PORTA, 8,  PWM_TIM1, 1 }, { SK_PORTE, 9,  PWM_TIM1, 1 },
+	{ SK_PORTA, 9,  PWM_TIM1, 2 }, { SK_PORTE, 11, PWM_TIM1, 2 },
+	{ SK_PORTA, 10, PWM_TIM1, 3 }, { SK_PORTE, 13, PWM_TIM1, 3 },
+	{ SK_PORTA, 11, PWM_TIM1, 4 }, { SK_PORTE, 14, PWM_TIM1, 4 },
+
+	{ SK_PORTA, 0,  PWM_TIM2, 1 }, { SK_PORTA, 5,  PWM_TIM2, 1 }, { SK_PORTA, 15, PWM_TIM2, 1 },
+	{ SK_PORTA, 1,  PWM_TIM2, 2 }, { SK_PORTB, 3,  PWM_TIM2, 2 },
+	{ SK_PORTA, 2,  PWM_TIM2, 3 }, { SK_PORTB, 10, PWM_TIM2, 3 },
+	{ SK_PORTA, 3,  PWM_TIM2, 4 }, { SK_PORTB, 11, PWM_TIM2, 4 },
+
+	{ SK_PORTA, 6,  PWM_TIM3, 1 }, { SK_PORTB, 4,  PWM_TIM3, 1 }, { SK_PORTC, 6,  PWM_TIM3, 1 },
+	{ SK_PORTA, 7,  PWM_TIM3, 2 }, { SK_PORTB, 5,  PWM_TIM3, 2 }, { SK_PORTC, 7,  PWM_TIM3, 2 },
+	{ SK_PORTB, 0,  PWM_TIM3, 3 }, { SK_PORTC, 8,  PWM_TIM3, 3 },
+	{ SK_PORTB, 1,  PWM_TIM3, 4 }, { SK_PORTC, 9,  PWM_TIM3, 4 },
+
+	{ SK_PORTB, 6,  PWM_TIM4, 1 }, { SK_PORTD, 12, PWM_TIM4, 1 },
+	{ SK_PORTB, 7,  PWM_TIM4, 2 }, { SK_PORTD, 13, PWM_TIM4, 2 },
+	{ SK_PORTB, 8,  PWM_TIM4, 3 }, { SK_PORTD, 14, PWM_TIM4, 3 },
+	{ SK_PORTB, 9,  PWM_TIM4, 4 }, { SK_PORTD, 15, PWM_TIM4, 4 },
+
+	{ SK_PORTA, 0,  PWM_TIM5, 1 }, { SK_PORTH, 10, PWM_TIM5, 1 },
+	{ SK_PORTA, 1,  PWM_TIM5, 2 }, { SK_PORTH, 11, PWM_TIM5, 2 },
+	{ SK_PORTA, 2,  PWM_TIM5, 3 }, { SK_PORTH, 12, PWM_TIM5, 3 },
+	{ SK_PORTA, 3,  PWM_TIM5, 4 },
+
+	{ SK_PORTC, 6,  PWM_TIM8, 1 }, { SK_PORTC, 7,  PWM_TIM8, 2 },
+	{ SK_PORTC, 8,  PWM_TIM8, 3 }, { SK_PORTC, 9,  PWM_TIM8, 4 },
+
+	{ SK_PORTA, 2,  PWM_TIM9, 1 }, { SK_PORTE, 5,  PWM_TIM9, 1 },
+	{ SK_PORTA, 3,  PWM_TIM9, 2 }, { SK_PORTE, 6,  PWM_TIM9, 2 },
+	{ SK_PORTB, 8,  PWM_TIM10, 1 }, { SK_PORTF, 6,  PWM_TIM10, 1 },
+	{ SK_PORTB, 9,  PWM_TIM11, 1 }, { SK_PORTF, 7,  PWM_TIM11, 1 },
+
+	{ SK_PORTB, 14, PWM_TIM12, 1 }, { SK_PORTH, 6,  PWM_TIM12, 1 },
+	{ SK_PORTB, 15, PWM_TIM12, 2 }, { SK_PORTH, 9,  PWM_TIM12, 2 },
+	{ SK_PORTA, 6,  PWM_TIM13, 1 }, { SK_PORTF, 8,  PWM_TIM13, 1 },
+	{ SK_PORTA, 7,  PWM_TIM14, 1 }, { SK_PORTF, 9,  PWM_TIM14, 1 },
+
+#if !(SK_USE_SIZE_OPTIMIZATIONS)
+	{ SK_PORTI, 0,  PWM_TIM5, 4 },
+	{ SK_PORTI, 5,  PWM_TIM8, 1 }, { SK_PORTI, 6,  PWM_TIM8, 2 },
+	{ SK_PORTI, 7,  PWM_TIM8, 3 }, { SK_PORTI, 2,  PWM_TIM8, 4 },
+#endif
+};
+
+
+/** Return output compare id (TIM_OC1 .. TIM_OC4) of channel (private) */
+static inline enum tim_oc_id pwm_oc(const struct sk_pwm *pwm)
+{
+	// tim_oc_id interleaves main and complementary outputs
+	return (enum tim_oc_id)((pwm->channel - 1) * 2);
+}
+
+
+sk_err sk_pwm_init(struct sk_pwm *pwm, sk_pin pin, uint32_t tim, uint32_t freq_hz,
+				   uint32_t resolution)
+{
+	if ((NULL == pwm) || (0 == freq_hz) || (1 == resolution))
+		return SK_EWRONGARG;
+
+	const struct pwm_pinmap *map = NULL;
+	for (uint32_t i = 0; i < sk_arr_len(pwm_pins); i++) {
+		const struct pwm_pinmap *m = &pwm_pins[i];
+		if ((m->port == pin.port) && (m->pin == pin.pin) &&
+			((0 == tim) || (pwm_tims[m->timidx].tim == tim))) {
+			map = m;
+			break;
+		}
+	}
+	if (NULL == map)
+		return SK_EUNAVAILABLE;
+
+	const struct pwm_tim *t = &pwm_tims[map->timidx];
+	// Compare value of resolution (100% duty) must fit into CCR, so ARR can not be the maximum
+	uint32_t maxperiod = t->is32bit ? 0xFFFFFFFE : 0xFFFE;
+	uint32_t clock = sk_tim_get_clock(t->tim);
+	uint32_t psc, arr;
+	if (0 == resolution) {
+		if (SK_EOK != sk_tim_solve_rate(clock, freq_hz, maxperiod, &psc, &arr))
+			return SK_ERANGE;
+	} else {
+		uint64_t ticks = (uint64_t)freq_hz * resolution;
+		uint32_t div = (clock + ticks / 2) / ticks;
+		if ((ticks > clock) || (0 == div) || (div > 0x10000) || (resolution - 1 > maxperiod))
+			return SK_ERANGE;
+		psc = div - 1;
+		arr = resolution - 1;
+	}
+
+	rcc_periph_clock_enable(t->rcc);
+	// Channels of running timer share its time base, which is not touched then
+	if (TIM_CR1(t->tim) & TIM_CR1_CEN) {
+		if ((TIM_PSC(t->tim) != psc) || (TIM_ARR(t->tim) != arr))
+			return SK_EUNAVAILABLE;
+	} else {
+		rcc_periph_reset_pulse(t->rst);
+		timer_set_prescaler(t->tim, psc);
+		timer_set_period(t->tim, arr);
+		timer_enable_preload(t->tim);
+		timer_generate_event(t->tim, TIM_EGR_UG);	// load prescaler and period
+	}
+
+	pwm->tim = t->tim;
+	pwm->channel = map->channel;
+	pwm->resolution = arr + 1;
+	pwm->freq_hz = clock / ((psc + 1) * ((uint64_t)arr + 1));
+	pwm->__timidx = map->timidx;
+
+	enum tim_oc_id oc = pwm_oc(pwm);
+	timer_disable_oc_output(t->tim, oc);
+	timer_set_oc_mode(t->tim, oc, TIM_OCM_PWM1);
+	timer_enable_oc_preload(t->tim, oc);
+	timer_set_oc_value(t->tim, oc, 0);
+	if (pin.isinverse)
+		timer_set_oc_polarity_low(t->tim, oc);
+	else
+		timer_set_oc_polarity_high(t->tim, oc);
+	timer_enable_oc_output(t->tim, oc);
+	if (t->isadvanced)
+		timer_enable_break_main_output(t->tim);
+	timer_enable_counter(t->tim);
+
+	// Switch pin to timer output only after channel is set up, so it starts inactive
+	const struct sk_pin_cfg cfg = {
+		SK_PIN_CFG_PIN(pin),
+		.mode = GPIO_MODE_AF,
+		.pupd = GPIO_PUPD_NONE,
+		.otype = GPIO_OTYPE_PP,
+		.ospeed = GPIO_OSPEED_50MHZ,
+		.af = t->af
+	};
+	sk_pin_cfg_apply(&cfg, 1);
+	return SK_EOK;
+}
+
+
+void sk_pwm_set_duty(const struct sk_pwm *pwm, uint32_t duty)
+{
+	if (NULL == pwm)
+		return;
+	if (duty > pwm->resolution)
+		duty = pwm->resolution;
+	timer_set_oc_value(pwm->tim, pwm_oc(pwm), duty);
+}
+
+
+/** Return address of channel compare register (private) */
+static inline uint32_t pwm_ccr_addr(const struct sk_pwm *pwm)
+{
+	return (uint32_t)&TIM_CCR1(pwm->tim) + 4 * (pwm->channel - 1);
+}
+
+
+/**
+ * Return `true` if timer update DMA stream was last set up for sequence of this channel
+ * (private). Stream is shared by all timer channels, so they are told apart by target address
+ */
+static bool pwm_seq_is_owner(const struct sk_pwm *pwm)
+{
+	const struct pwm_tim *t = &pwm_tims[pwm->__timidx];
+	return t->dma && (DMA_SPAR(t->dma, t->stream) == pwm_ccr_addr(pwm));
+}
+
+
+bool sk_pwm_seq_is_running(const struct sk_pwm *pwm)
+{
+	if ((NULL == pwm) || !pwm_seq_is_owner(pwm))
+		return false;
+
+	const struct pwm_tim *t = &pwm_tims[pwm->__timidx];
+	return DMA_SCR(t->dma, t->stream) & DMA_SxCR_EN;
+}
+
+
+sk_err sk_pwm_seq_start(struct sk_pwm *pwm, const uint16_t *seq, uint16_t len, uint16_t repeat,
+						bool isloop)
+{
+	if ((NULL == pwm) || (NULL == seq) || (0 == len) || (0 == repeat) || (repeat > 256))
+		return SK_EWRONGARG;
+
+	const struct pwm_tim *t = &pwm_tims[pwm->__timidx];
+	if (!t->dma || ((repeat > 1) && !t->isadvanced))
+		return SK_EUNAVAILABLE;
+	sk_pwm_seq_stop(pwm);
+	// Update request is shared by all timer channels
+	if (DMA_SCR(t->dma, t->stream) & DMA_SxCR_EN)
+		return SK_EUNAVAILABLE;
+
+	rcc_periph_clock_enable((DMA1 == t->dma) ? RCC_DMA1 : RCC_DMA2);
+	timer_disable_irq(pwm->tim, TIM_DIER_UDE);
+	if (t->isadvanced)
+		timer_set_repetition_counter(pwm->tim, repeat - 1);
+
+	dma_stream_reset(t->dma, t->stream);
+	dma_channel_select(t->dma, t->stream, (uint32_t)t->chsel << DMA_SxCR_CHSEL_SHIFT);
+	dma_set_priority(t->dma, t->stream, DMA_SxCR_PL_HIGH);
+	dma_set_transfer_mode(t->dma, t->stream, DMA_SxCR_DIR_MEM_TO_PERIPHERAL);
+	dma_set_memory_size(t->dma, t->stream, DMA_SxCR_MSIZE_16BIT);
+	dma_set_peripheral_size(t->dma, t->stream, DMA_SxCR_PSIZE_16BIT);
+	dma_enable_memory_increment_mode(t->dma, t->stream);
+	dma_disable_peripheral_increment_mode(t->dma, t->stream);
+	dma_enable_direct_mode(t->dma, t->stream);
+	if (isloop)
+		dma_enable_circular_mode(t->dma, t->stream);
+	dma_set_peripheral_address(t->dma, t->stream, pwm_ccr_addr(pwm));
+	dma_set_memory_address(t->dma, t->stream, (uint32_t)seq);
+	dma_set_number_of_data(t->dma, t->stream, len);
+	dma_enable_stream(t->dma, t->stream);
+
+	// Each update event copies the next value into preload register, which becomes active
+	// at the following update. So values are output back to back, one per (repeated) period
+	timer_enable_irq(pwm->tim, TIM_DIER_UDE);
+	return SK_EOK;
+}
+
+
+void sk_pwm_seq_stop(struct sk_pwm *pwm)
+{
+	// Finished sequence still holds update request and repetition counter, so clean up as well
+	if ((NULL == pwm) || !pwm_seq_is_owner(pwm))
+		return;
+
+	const struct pwm_tim *t = &pwm_tims[pwm->__timidx];
+	timer_disable_irq(pwm->tim, TIM_DIER_UDE);
+	dma_disable_stream(t->dma, t->stream);
+	while (DMA_SCR(t->dma, t->stream) & DMA_SxCR_EN);	// EN clears when stream stops
+	if (t->isadvanced)
+		timer_set_repetition_counter(pwm->tim, 0);
+}
@@ -0,0 +1,149 @@
+/**
+ * libsk lock-free single-producer single-consumer byte ring
+ */
+
+#include "ring.h"
+#include <stddef.h>
+#include <string.h>
+
+
+// Barriers follow the producer/consumer pattern of AN321 (ARM Cortex-M Programming Guide to
+// Memory Barrier Instructions). On a single Cortex-M4 core they mostly serve as compiler
+// barriers, but also keep the ring correct when either side is a DMA or another bus master
+
+
+sk_err sk_ring_init(sk_ring *ring, uint8_t *buf, uint32_t buflen)
+{
+	// Power of two has a single bit set. Limit keeps byte counts within int32_t
+	if ((NULL == ring) || (NULL == buf) || (0 == buflen) || (buflen & (buflen - 1)) ||
+		(buflen > 0x40000000ul))
+		return SK_EWRONGARG;
+
+	*ring = SK_RING_INITIALIZER(buf, buflen);
+	return SK_EOK;
+}
+
+
+sk_err sk_ring_put(sk_ring *ring, const void *data, uint32_t len)
+{
+	if ((NULL == ring) || ((NULL == data) && len))
+		return SK_EWRONGARG;
+
+	// memcpy is not allowed to be called with NULL, even for 0 bytes
+	if (0 == len)
+		return SK_EOK;
+
+	uint32_t size = sk_ring_get_size(ring);
+	if (len > size)
+		return SK_ERANGE;
+
+	uint32_t head = ring->__head;
+	if (size - (head - ring->__tail) < len)
+		return SK_EFULL;
+	__DMB();	// consumer is done with free slots we are going to overwrite
+
+	// Data either fits before the end of buffer or wraps once
+	uint32_t off = head & ring->__mask;
+	uint32_t first = size - off;
+	if (first > len)
+		first = len;
+	memcpy(&ring->buf[off], data, first);
+	memcpy(ring->buf, (const uint8_t *)data + first, len - first);
+
+	__DMB();	// data must be in memory before consumer can see new head
+	ring->__head = head + len;
+	return SK_EOK;
+}
+
+
+int32_t sk_ring_get(sk_ring *ring, void *data, uint32_t len)
+{
+	if ((NULL == ring) || ((NULL == data) && len))
+		return SK_EWRONGARG;
+
+	// reading 0 elements returns 0 read, as with sk_bfifo_get
+	if (0 == len)
+		return 0;
+
+	uint32_t tail = ring->__tail;
+	uint32_t used = ring->__head - tail;
+	if (0 == used)
+		return SK_EEMPTY;
+	__DMB();	// data written by producer before head must be read after head
+
+	if (len > used)
+		len = used;
+	uint32_t off = tail & ring->__mask;
+	uint32_t first = sk_ring_get_size(ring) - off;
+	if (first > len)
+		first = len;
+	memcpy(data, &ring->buf[off], first);
+	memcpy((uint8_t *)data + first, ring->buf, len - first);
+
+	__DMB();	// finish reading slots before producer is allowed to reuse them
+	ring->__tail = tail + len;
+	return len;
+}
+
+
+uint32_t sk_ring_reserve(sk_ring *ring, uint8_t **span)
+{
+	if ((NULL == ring) || (NULL == span))
+		return 0;
+
+	uint32_t head = ring->__head;
+	uint32_t nfree = sk_ring_get_size(ring) - (head - ring->__tail);
+	__DMB();	// consumer is done with free slots returned to producer
+
+	uint32_t off = head & ring->__mask;
+	uint32_t tillend = sk_ring_get_size(ring) - off;
+	*span = &ring->buf[off];
+	return (nfree < tillend) ? nfree : tillend;
+}
+
+
+sk_err sk_ring_commit(sk_ring *ring, uint32_t len)
+{
+	if (NULL == ring)
+		return SK_EWRONGARG;
+
+	// Same as with bfifo, commit may not go past the region handed out by reserve
+	uint8_t *span;
+	if (len > sk_ring_reserve(ring, &span))
+		return SK_ERANGE;
+
+	__DMB();	// data must be in memory before consumer can see new head
+	ring->__head += len;	// only producer writes head, so this is not a race
+	return SK_EOK;
+}
+
+
+uint32_t sk_ring_peek(sk_ring *ring, const uint8_t **span)
+{
+	if ((NULL == ring) || (NULL == span))
+		return 0;
+
+	uint32_t tail = ring->__tail;
+	uint32_t used = ring->__head - tail;
+	__DMB();	// data written by producer before head must be read after head
+
+	uint32_t off = tail & ring->__mask;
+	uint32_t tillend = sk_ring_get_size(ring) - off;
+	*span = &ring->buf[off];
+	return (used < tillend) ? used : tillend;
+}
+
+
+sk_err sk_ring_consume(sk_ring *ring, uint32_t len)
+{
+	if (NULL == ring)
+		return SK_EWRONGARG;
+
+	const uint8_t *span;
+	if (len > sk_ring_peek(ring, &span))
+		return SK_ERANGE;
+
+	__DMB();	// finish reading slots before producer is allowed to reuse them
+	ring->__tail += len;	// only consumer writes tail
+	return SK_EOK;
+}
@@ -0,0 +1,278 @@
+/**
+ * libsk software timers
+ */
+
+#include "swtimer.h"
+#include "tick.h"
+#include <libopencm3/cm3/cortex.h>
+#include <stddef.h>
+
+
+#define SLOTMASK	(__SK_SWTIMER_SLOTS - 1)
+// Ticks covered by all wheels
+#define SPAN_BITS	(__SK_SWTIMER_LEVELS * __SK_SWTIMER_SLOTBITS)
+
+
+/** Put timer into wheel slot according to its expiry. Interrupts must be masked (private) */
+static void wheel_insert(struct sk_swtimer_wheel *wheel, struct sk_swtimer *timer)
+{
+	uint32_t now = wheel->__now;
+	uint32_t expires = timer->__expires;
+
+	// Timer due right now may only come from cascade, which runs before the current slot
+	// of wheel 0 is processed. So it lands right into that slot. Should timer be already
+	// overdue for some reason, expire it on the next tick
+	if ((int32_t)(expires - now) < 0) {
+		expires = now + 1;
+		timer->__expires = expires;
+	}
+
+	uint32_t delta = expires - now;
+	if (delta >= (1ul << SPAN_BITS)) {
+		// park in the farthest slot. Will be re-inserted when this slot is cascaded
+		expires = now + (1ul << SPAN_BITS) - 1;
+		delta = expires - now;
+	}
+
+	uint32_t level = 0;
+	while (delta >= (1ul << ((level + 1) * __SK_SWTIMER_SLOTBITS)))
+		level++;
+	uint32_t idx = (expires >> (level * __SK_SWTIMER_SLOTBITS)) & SLOTMASK;
+
+	struct sk_swtimer **head = &wheel->__slots[level][idx];
+	timer->__next = *head;
+	if (NULL != *head)
+		(*head)->__pprev = &timer->__next;
+	timer->__pprev = head;
+	*head = timer;
+	timer->__slot = (level << __SK_SWTIMER_SLOTBITS) | idx;
+	wheel->__occupied[level] |= (1ull << idx);
+}
+
+
+/** Remove timer from wheel slot. Interrupts must be masked (private) */
+static void wheel_remove(struct sk_swtimer_wheel *wheel, struct sk_swtimer *timer)
+{
+	*timer->__pprev = timer->__next;
+	if (NULL != timer->__next)
+		timer->__next->__pprev = timer->__pprev;
+	timer->__pprev = NULL;
+
+	uint32_t level = timer->__slot >> __SK_SWTIMER_SLOTBITS;
+	uint32_t idx = timer->__slot & SLOTMASK;
+	if (NULL == wheel->__slots[level][idx])
+		wheel->__occupied[level] &= ~(1ull << idx);
+}
+
+
+/** Append timer to deferred list. Interrupts must be masked (private) */
+static void ready_append(struct sk_swtimer_wheel *wheel, struct sk_swtimer *timer)
+{
+	timer->__rnext = NULL;
+	timer->__rpprev = wheel->__readytail;
+	*wheel->__readytail = timer;
+	wheel->__readytail = &timer->__rnext;
+}
+
+
+/** Remove timer from deferred list. Interrupts must be masked (private) */
+static void ready_remove(struct sk_swtimer_wheel *wheel, struct sk_swtimer *timer)
+{
+	*timer->__rpprev = timer->__rnext;
+	if (NULL != timer->__rnext)
+		timer->__rnext->__rpprev = timer->__rpprev;
+	else
+		wheel->__readytail = timer->__rpprev;
+	timer->__rpprev = NULL;
+}
+
+
+void sk_swtimer_wheel_init(struct sk_swtimer_wheel *wheel)
+{
+	wheel->__now = sk_tick_get_current();
+	for (uint32_t l = 0; l < __SK_SWTIMER_LEVELS; l++) {
+		wheel->__occupied[l] = 0;
+		for (uint32_t i = 0; i < __SK_SWTIMER_SLOTS; i++)
+			wheel->__slots[l][i] = NULL;
+	}
+	wheel->__ready = NULL;
+	wheel->__readytail = &wheel->__ready;
+}
+
+
+void sk_swtimer_init(struct sk_swtimer *timer, sk_swtimer_func_t func, void *arg,
+					 bool isdeferred)
+{
+	timer->func = func;
+	timer->arg = arg;
+	timer->period = 0;
+	timer->isdeferred = isdeferred;
+	timer->noverruns = 0;
+	timer->__next = NULL;
+	timer->__pprev = NULL;
+	timer->__rnext = NULL;
+	timer->__rpprev = NULL;
+	timer->__expires = 0;
+	timer->__slot = 0;
+}
+
+
+sk_err sk_swtimer_start(struct sk_swtimer_wheel *wheel, struct sk_swtimer *timer,
+						uint32_t delay, uint32_t period)
+{
+	if ((NULL == wheel) || (NULL == timer) || (NULL == timer->func) || (0 == delay))
+		return SK_EWRONGARG;
+	// otherwise expiry would look overdue and fire on the next tick (see wheel_insert)
+	if ((delay > SK_SWTIMER_MAX_TICKS) || (period > SK_SWTIMER_MAX_TICKS))
+		return SK_ERANGE;
+
+	bool masked = cm_mask_interrupts(true);
+	if (NULL != timer->__pprev)
+		wheel_remove(wheel, timer);
+	timer->period = period;
+	timer->__expires = wheel->__now + delay;
+	wheel_insert(wheel, timer);
+	cm_mask_interrupts(masked);
+	return SK_EOK;
+}
+
+
+void sk_swtimer_cancel(struct sk_swtimer_wheel *wheel, struct sk_swtimer *timer)
+{
+	if ((NULL == wheel) || (NULL == timer))
+		return;
+
+	bool masked = cm_mask_interrupts(true);
+	if (NULL != timer->__pprev)
+		wheel_remove(wheel, timer);
+	if (NULL != timer->__rpprev)
+		ready_remove(wheel, timer);
+	cm_mask_interrupts(masked);
+}
+
+
+/** Move all timers of wheel slot to lower wheels. Interrupts must be masked (private) */
+static void wheel_cascade(struct sk_swtimer_wheel *wheel, uint32_t level, uint32_t idx)
+{
+	struct sk_swtimer *timer = wheel->__slots[level][idx];
+	wheel->__slots[level][idx] = NULL;
+	wheel->__occupied[level] &= ~(1ull << idx);
+
+	while (NULL != timer) {
+		struct sk_swtimer *next = timer->__next;
+		wheel_insert(wheel, timer);
+		timer = next;
+	}
+}
+
+
+/** Advance wheel by one tick and expire timers (private) */
+static void wheel_step(struct sk_swtimer_wheel *wheel)
+{
+	bool masked = cm_mask_interrupts(true);
+	uint32_t now = ++wheel->__now;
+
+	// When lower wheel completes its turn, bring next slot of the higher one down
+	for (uint32_t level = 1; level < __SK_SWTIMER_LEVELS; level++) {
+		if (now & ((1ul << (level * __SK_SWTIMER_SLOTBITS)) - 1))
+			break;
+		uint32_t idx = (now >> (level * __SK_SWTIMER_SLOTBITS)) & SLOTMASK;
+		if (wheel->__occupied[level] & (1ull << idx))
+			wheel_cascade(wheel, level, idx);
+	}
+
+	// Every timer in wheel 0 slot expires right now. Detach the whole slot first, so that
+	// timers re-armed by callbacks can not end up in the list being processed
+	uint32_t idx = now & SLOTMASK;
+	struct sk_swtimer *expired = wheel->__slots[0][idx];
+	wheel->__slots[0][idx] = NULL;
+	wheel->__occupied[0] &= ~(1ull << idx);
+	if (NULL != expired)
+		expired->__pprev = &expired;
+
+	while (NULL != expired) {
+		struct sk_swtimer *timer = expired;
+		// detached list has no slot, so unlink by hand
+		expired = timer->__next;
+		if (NULL != expired)
+			expired->__pprev = &expired;
+		timer->__pprev = NULL;
+
+		if (timer->period) {
+			timer->__expires += timer->period;
+			wheel_insert(wheel, timer);
+		}
+
+		if (timer->isdeferred) {
+			if (NULL != timer->__rpprev)
+				timer->noverruns++;
+			else
+				ready_append(wheel, timer);
+			continue;
+		}
+
+		// Run callback with interrupts enabled. It is free to start or cancel any timer.
+		// Canceling timer from the expired list unlinks it from local list head here
+		cm_mask_interrupts(masked);
+		timer->func(timer, timer->arg);
+		cm_mask_interrupts(true);
+	}
+
+	cm_mask_interrupts(masked);
+}
+
+
+void sk_swtimer_wheel_tick(struct sk_swtimer_wheel *wheel)
+{
+	uint32_t target = sk_tick_get_current();
+	while (wheel->__now != target)
+		wheel_step(wheel);
+}
+
+
+uint32_t sk_swtimer_run_deferred(struct sk_swtimer_wheel *wheel)
+{
+	uint32_t cnt = 0;
+	while (true) {
+		bool masked = cm_mask_interrupts(true);
+		struct sk_swtimer *timer = wheel->__ready;
+		if (NULL != timer)
+			ready_remove(wheel, timer);
+		cm_mask_interrupts(masked);
+
+		if (NULL == timer)
+			break;
+		timer->func(timer, timer->arg);
+		cnt++;
+	}
+	return cnt;
+}
+
+
+uint32_t sk_swtimer_get_idle_ticks(struct sk_swtimer_wheel *wheel)
+{
+	bool masked = cm_mask_interrupts(true);
+	uint32_t now = wheel->__now;
+	uint32_t ticks = UINT32_MAX;
+
+	uint64_t occ = wheel->__occupied[0];
+	if (occ) {
+		// rotate bitmap so that bit 0 is the slot of the next tick
+		uint32_t shift = (now + 1) & SLOTMASK;
+		occ = (occ >> shift) | (shift ? (occ << (__SK_SWTIMER_SLOTS - shift)) : 0);
+		ticks = 1 + __builtin_ctzll(occ);
+	}
+
+	for (uint32_t level = 1; level < __SK_SWTIMER_LEVELS; level++) {
+		if (wheel->__occupied[level]) {
+			// higher wheels need attention no later than at the next wheel 0 turn
+			uint32_t turn = __SK_SWTIMER_SLOTS - (now & SLOTMASK);
+			if (turn < ticks)
+				ticks = turn;
+			break;
+		}
+	}
+
+	cm_mask_interrupts(masked);
+	return ticks;
+}
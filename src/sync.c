@@ -3,6 +3,7 @@
  */
 
 #include "sync.h"
+#include "delay.h"
 #include "intrinsics.h"
 #include <stdbool.h>
 #include <stddef.h>
@@ -17,6 +18,8 @@ void sk_lock_unlock(sk_lock_t *lock)
 {
 	__DMB();	// ensure all previous memory transfers completed before next writes
 	*lock = __SK_LOCK_UNLOCKED;
+	__DSB();	// lock must be released before waiters are woken up
+	__SEV();
 }
 
 
@@ -47,12 +50,97 @@ bool sk_lock_trylock(sk_lock_t *lock)
 }
 
 
-// Busy-wait (loop) trying to capture a lock
+/** Account lock acquisition. Called by the new holder (private) */
+static void lock_stats_add(struct sk_lock_stats *stats, bool iscontended, uint32_t waitcycles,
+						   uint32_t nwakeups)
+{
+	stats->nacquires++;
+	if (!iscontended)
+		return;
+	stats->ncontended++;
+	stats->nwakeups += nwakeups;
+	stats->waitcycles += waitcycles;
+	if (waitcycles > stats->maxwaitcycles)
+		stats->maxwaitcycles = waitcycles;
+}
+
+
+// Sleep between attempts trying to capture a lock
+void sk_lock_spinlock_stats(sk_lock_t *lock, struct sk_lock_stats *stats)
+{
+	if (sk_lock_trylock(lock)) {
+		if (NULL != stats)
+			lock_stats_add(stats, false, 0, 0);
+		return;
+	}
+
+	uint32_t start = sk_cycles_get_current();
+	uint32_t nwakeups = 0;
+	do {
+		// If lock was released after the failed attempt, SEV has already set event register
+		// and WFE returns at once, so the release can not be missed
+		__WFE();
+		nwakeups++;
+	} while (!sk_lock_trylock(lock));
+
+	if (NULL != stats)
+		lock_stats_add(stats, true, sk_cycles_get_current() - start, nwakeups);
+}
+
+
 void sk_lock_spinlock(sk_lock_t *lock)
 {
-	// Simple, but not very efficient implementation
-	while (!sk_lock_trylock(lock));
-	return;
+	sk_lock_spinlock_stats(lock, NULL);
+}
+
+
+// Ticket lock
+
+void sk_ticketlock_lock(sk_ticketlock *lock)
+{
+	uint32_t ticket = sk_atomic_add(&lock->__next, 1);
+	if (sk_atomic_load(&lock->__owner) == ticket) {
+#if SK_USE_LOCK_STATS
+		lock_stats_add(&lock->stats, false, 0, 0);
+#endif
+		return;
+	}
+
+	uint32_t start = sk_cycles_get_current();
+	uint32_t nwakeups = 0;
+	do {
+		__WFE();
+		nwakeups++;
+	} while (sk_atomic_load(&lock->__owner) != ticket);
+
+#if SK_USE_LOCK_STATS
+	lock_stats_add(&lock->stats, true, sk_cycles_get_current() - start, nwakeups);
+#else
+	(void)start;
+	(void)nwakeups;
+#endif
+}
+
+
+bool sk_ticketlock_trylock(sk_ticketlock *lock)
+{
+	// Lock is free only when there are no tickets handed out past the served one
+	uint32_t owner = sk_atomic_load(&lock->__owner);
+	if (!sk_atomic_cas(&lock->__next, owner, owner + 1))
+		return false;
+#if SK_USE_LOCK_STATS
+	lock_stats_add(&lock->stats, false, 0, 0);
+#endif
+	return true;
+}
+
+
+void sk_ticketlock_unlock(sk_ticketlock *lock)
+{
+	// Only the holder writes owner, so plain increment is not a race
+	sk_atomic_store(&lock->__owner, lock->__owner + 1);
+	__DSB();	// next ticket must be served before waiters are woken up
+	__SEV();
 }
 
 
@@ -119,7 +207,7 @@ sk_err sk_bfifo_put(sk_bfifo_t *fifo, uint8_t *barr, uint32_t len)
 	if (newwr == fifo->rdidx)
 		fifo->isfull = true;
 
-	// memory barrier here
+	__DMB();	// data must be in memory before consumer can see new index
 
 	// update index
 	fifo->wridx = newwr;
@@ -161,3 +249,81 @@ int32_t sk_bfifo_get(sk_bfifo_t *fifo, uint8_t *barr, uint32_t len)
 }
 
 
+sk_bfifo_len_t sk_bfifo_get_used(sk_bfifo_t *fifo)
+{
+	return fifo->buflen - _sk_bfifo_numleft(fifo);
+}
+
+
+sk_bfifo_len_t sk_bfifo_get_free(sk_bfifo_t *fifo)
+{
+	return _sk_bfifo_numleft(fifo);
+}
+
+
+// Span functions share isfull with the other side. Callers provide locking (see sync.h)
+sk_bfifo_len_t sk_bfifo_reserve(sk_bfifo_t *fifo, uint8_t **span)
+{
+	if ((NULL == fifo) || (NULL == span))
+		return 0;
+
+	sk_bfifo_len_t left = _sk_bfifo_numleft(fifo);
+	sk_bfifo_len_t tillend = fifo->buflen - fifo->wridx;
+	*span = &fifo->buf[fifo->wridx];
+	return (left < tillend) ? left : tillend;
+}
+
+
+sk_err sk_bfifo_commit(sk_bfifo_t *fifo, sk_bfifo_len_t len)
+{
+	if (NULL == fifo)
+		return SK_EWRONGARG;
+
+	uint8_t *span;
+	if (len > sk_bfifo_reserve(fifo, &span))
+		return SK_ERANGE;
+	if (0 == len)
+		return SK_EOK;
+
+	// region never crosses buffer end, so there is no need for modulo here
+	sk_bfifo_len_t newwr = fifo->wridx + len;
+	if (newwr == fifo->buflen)
+		newwr = 0;
+	if (newwr == fifo->rdidx)
+		fifo->isfull = true;
+
+	__DMB();	// data must be in memory before consumer can see new index
+	fifo->wridx = newwr;
+	return SK_EOK;
+}
+
+
+sk_bfifo_len_t sk_bfifo_peek(sk_bfifo_t *fifo, const uint8_t **span)
+{
+	if ((NULL == fifo) || (NULL == span))
+		return 0;
+
+	sk_bfifo_len_t used = fifo->buflen - _sk_bfifo_numleft(fifo);
+	sk_bfifo_len_t tillend = fifo->buflen - fifo->rdidx;
+	*span = &fifo->buf[fifo->rdidx];
+	return (used < tillend) ? used : tillend;
+}
+
+
+sk_err sk_bfifo_consume(sk_bfifo_t *fifo, sk_bfifo_len_t len)
+{
+	if (NULL == fifo)
+		return SK_EWRONGARG;
+
+	const uint8_t *span;
+	if (len > sk_bfifo_peek(fifo, &span))
+		return SK_ERANGE;
+	if (0 == len)
+		return SK_EOK;
+
+	sk_bfifo_len_t newrd = fifo->rdidx + len;
+	__DMB();	// finish reading slots before producer is allowed to reuse them
+	fifo->rdidx = (newrd == fifo->buflen) ? 0 : newrd;
+	fifo->isfull = false;
+	return SK_EOK;
+}
@@ -1,10 +1,14 @@
 #include "tick.h"
+#include "config.h"
 #include "intrinsics.h"
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/scb.h>
 #include <libopencm3/cm3/systick.h>
 #include <libopencm3/stm32/rcc.h>
 
 volatile uint32_t __sk_nticks = 0;
+volatile uint32_t __sk_nticks_hi = 0;
 
 
 // SysTick default ISR. May be overriden by user.
@@ -50,6 +54,7 @@ bool sk_tick_init(uint32_t period, uint_fast8_t irq_priority)
 	nvic_enable_irq(NVIC_SYSTICK_IRQ);
 
 	__sk_tick_set_current(0);
+	__sk_nticks_hi = 0;
 
 	systick_counter_enable();
 	return true;
@@ -74,6 +79,12 @@ void sk_tick_delay_ms(uint32_t ms)
 {
 	uint32_t cur = sk_tick_get_current();
 	uint32_t delta = (sk_get_tick_rate_hz() / 1000) * ms;
+#if SK_USE_TICKLESS
+	// wait the same number of ticks as below, but sleep through them
+	uint32_t elapsed;
+	while ((elapsed = sk_tick_get_current() - cur) <= delta)
+		sk_tick_idle(delta + 1 - elapsed);
+#else
 	uint32_t next = cur + delta;
 
 	// take overflow into account
@@ -84,4 +95,161 @@ void sk_tick_delay_ms(uint32_t ms)
 		while (sk_tick_get_current() <= next)
 			__WFI();
 	}
+#endif
+}
+
+
+// Tickless idle
+
+// Minimum number of SysTick counts left till the tick boundary, for which reprogramming
+// is still done. Reprogramming takes a few dozens of cycles, and counts are lost meanwhile
+#define IDLE_MARGIN		32
+
+
+/** Add elapsed ticks to tick counter. Called with interrupts disabled (private) */
+static inline void tick_add(uint32_t n)
+{
+	uint32_t lo = __sk_nticks + n;
+	if (lo < __sk_nticks)
+		__sk_nticks_hi++;
+	__sk_nticks = lo;
+}
+
+
+/** Restart SysTick so that it wraps after `counts` counts and then runs normally (private) */
+static void tick_restart(uint32_t counts, uint32_t reload)
+{
+	systick_counter_disable();
+	STK_RVR = counts - 1;
+	STK_CVR = 0;		// any write clears counter, so RVR is loaded on the next count
+	systick_counter_enable();
+	while (!STK_CVR);	// wait until counter is loaded
+	// RVR is only used on the next wrap, so ticks after this one have normal period
+	STK_RVR = reload;
+}
+
+
+uint32_t sk_tick_idle(uint32_t nticks)
+{
+	uint32_t reload = systick_get_reload();
+	uint32_t period = reload + 1;
+	uint32_t maxticks = 0x1000000 / period;		// 24-bit counter
+	if (nticks > maxticks)
+		nticks = maxticks;
+
+	if (nticks < 2) {
+		// nothing to gain, simply wait for the next interrupt
+		__WFI();
+		return 0;
+	}
+
+	// Interrupts are masked, but still wake up WFI. They are taken after the counter is fixed
+	bool masked = cm_mask_interrupts(true);
+
+	systick_counter_disable();
+	uint32_t left = STK_CVR;	// counts till the next tick
+	if ((SCB_ICSR & SCB_ICSR_PENDSTSET) || (left < IDLE_MARGIN)) {
+		// tick is due right now
+		systick_counter_enable();
+		cm_mask_interrupts(masked);
+		return 0;
+	}
+
+	uint32_t sleep = left + (nticks - 1) * period;
+	tick_restart(sleep, reload);
+
+	__DSB();
+	__WFI();
+
+	uint32_t elapsed;
+	systick_counter_disable();
+	uint32_t cvr = STK_CVR;
+	if (SCB_ICSR & SCB_ICSR_PENDSTSET) {
+		// Slept till the deadline. Counter is already running with normal period.
+		// Pending tick ISR accounts for the last tick
+		elapsed = nticks;
+		tick_add(nticks - 1);
+		systick_counter_enable();
+	} else {
+		// Woken up by other interrupt. Find out how many tick boundaries were crossed
+		// and when the next one is due
+		uint32_t done = (sleep - 1) - cvr;
+		uint32_t rem;
+		if (done < left) {
+			elapsed = 0;
+			rem = left - done;
+		} else {
+			elapsed = 1 + (done - left) / period;
+			rem = period - (done - left) % period;
+		}
+		if (rem < IDLE_MARGIN) {
+			// tick boundary is too close, count it now
+			elapsed++;
+			rem += period;
+		}
+		tick_add(elapsed);
+		tick_restart(rem, reload);
+	}
+
+	cm_mask_interrupts(masked);
+	return elapsed;
+}
+
+
+uint64_t sk_time_now_raw(void)
+{
+	uint32_t hi, lo, cvr;
+	bool ispending;
+
+	do {
+		hi = __sk_nticks_hi;
+		lo = __sk_nticks;
+		cvr = STK_CVR;
+		// When counter has already reached zero, but tick ISR has not run yet (we are
+		// in ISR of higher priority or interrupts are disabled), tick counter lags behind.
+		// Pending SysTick exception tells us about that. COUNTFLAG can not be used here,
+		// as it is cleared on read and thus would be lost for others
+		ispending = SCB_ICSR & SCB_ICSR_PENDSTSET;
+		if (ispending) {
+			// wrap happened before pending bit was read, but maybe after CVR was read.
+			// Re-read to get value which surely follows the wrap
+			cvr = STK_CVR;
+		}
+		// retry if tick ISR ran in between
+	} while ((lo != __sk_nticks) || (hi != __sk_nticks_hi));
+
+	uint64_t ticks = (((uint64_t)hi << 32) | lo) + ispending;
+	// Counter goes down from reload value to 0, so each tick takes reload + 1 periods
+	uint32_t reload = systick_get_reload();
+	return ticks * (reload + 1) + (reload - cvr);
+}
+
+
+uint32_t sk_time_get_rate_hz(void)
+{
+	if (!(STK_CSR & STK_CSR_CLKSOURCE))
+		return rcc_ahb_frequency / 8;
+	return rcc_ahb_frequency;
+}
+
+
+/** Convert raw time to units of 1/scale seconds without 64-bit overflow (private) */
+static uint64_t time_raw_convert(uint64_t raw, uint32_t scale)
+{
+	uint32_t rate = sk_time_get_rate_hz();
+	uint64_t sec = raw / rate;
+	uint32_t rem = raw - sec * rate;
+	return sec * scale + ((uint64_t)rem * scale) / rate;
+}
+
+
+uint64_t sk_time_now_ns(void)
+{
+	return time_raw_convert(sk_time_now_raw(), 1000000000ul);
+}
+
+
+uint64_t sk_time_now_us(void)
+{
+	return time_raw_convert(sk_time_now_raw(), 1000000ul);
 }
@@ -0,0 +1,42 @@
+/**
+ * libsk timer helpers
+ */
+
+#include "tim.h"
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/timer.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+uint32_t sk_tim_get_clock(uint32_t tim)
+{
+	// TIM1, TIM8 .. TIM11 reside on APB2, the others on APB1
+	bool isapb2 = (TIM1 == tim) || (TIM8 == tim) || (TIM9 == tim) ||
+				  (TIM10 == tim) || (TIM11 == tim);
+	uint32_t bus = isapb2 ? rcc_apb2_frequency : rcc_apb1_frequency;
+
+	// bus prescaler of 1 means bus runs at AHB frequency
+	return (bus == rcc_ahb_frequency) ? bus : 2 * bus;
+}
+
+
+sk_err sk_tim_solve_rate(uint32_t clock, uint32_t rate_hz, uint32_t maxperiod,
+						 uint32_t *psc, uint32_t *arr)
+{
+	if ((NULL == psc) || (NULL == arr) || (0 == rate_hz) || (0 == maxperiod))
+		return SK_EWRONGARG;
+
+	uint32_t ticks = clock / rate_hz;
+	if (0 == ticks)
+		return SK_ERANGE;
+
+	// ticks = (PSC + 1) * (ARR + 1), where both terms are limited
+	uint32_t div = (ticks - 1) / ((uint64_t)maxperiod + 1) + 1;
+	if (div > 0x10000)
+		return SK_ERANGE;
+
+	*psc = div - 1;
+	*arr = ticks / div - 1;
+	return SK_EOK;
+}
@@ -0,0 +1,210 @@
+/**
+ * libsk waveform engine
+ */
+
+#include "wave.h"
+#include "intrinsics.h"
+#include "tim.h"
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/timer.h>
+#include <stddef.h>
+
+
+// TIM8_UP request is routed to DMA2 Stream 1 Channel 7 (see p. 9.3.3 RM0090, Table 43)
+#define WAVE_TIM		TIM8
+#define WAVE_DMA		DMA2
+#define WAVE_STREAM		DMA_STREAM1
+#define WAVE_CHANNEL	DMA_SxCR_CHSEL_7
+#define WAVE_IRQ		NVIC_DMA2_STREAM1_IRQ
+
+
+// There is only one set of hardware resources, so only one engine may be active at a time
+static struct sk_wave *active_wave = NULL;
+
+
+static inline void wave_set_addresses(uint32_t *m0, uint32_t *m1)
+{
+	dma_set_memory_address(WAVE_DMA, WAVE_STREAM, (uint32_t)m0);
+	dma_set_memory_address_1(WAVE_DMA, WAVE_STREAM, (uint32_t)m1);
+}
+
+
+sk_err sk_wave_init(struct sk_wave *wave, enum sk_port port, uint32_t *buf0, uint32_t *buf1,
+					uint16_t len, uint32_t rate_hz)
+{
+	if ((NULL == wave) || (NULL == buf0) || (NULL == buf1) || (0 == len) || (0 == rate_hz))
+		return SK_EWRONGARG;
+
+	uint32_t psc, arr;
+	if (SK_EOK != sk_tim_solve_rate(sk_tim_get_clock(WAVE_TIM), rate_hz, 0xFFFF, &psc, &arr))
+		return SK_ERANGE;
+
+	if (NULL != active_wave)
+		sk_wave_stop(active_wave);
+
+	wave->buf[0] = buf0;
+	wave->buf[1] = buf1;
+	wave->len = len;
+	wave->port = port;
+	wave->__front = 0;
+	wave->__swapstage = 0;
+	wave->__isrunning = false;
+	active_wave = wave;
+
+	rcc_periph_clock_enable(RCC_TIM8);
+	rcc_periph_clock_enable(RCC_DMA2);
+
+	rcc_periph_reset_pulse(RST_TIM8);
+	timer_set_prescaler(WAVE_TIM, psc);
+	timer_set_period(WAVE_TIM, arr);
+	timer_enable_preload(WAVE_TIM);
+	// Request DMA transfer on every update event
+	timer_enable_irq(WAVE_TIM, TIM_DIER_UDE);
+
+	dma_stream_reset(WAVE_DMA, WAVE_STREAM);
+	dma_channel_select(WAVE_DMA, WAVE_STREAM, WAVE_CHANNEL);
+	dma_set_priority(WAVE_DMA, WAVE_STREAM, DMA_SxCR_PL_VERY_HIGH);
+	dma_set_transfer_mode(WAVE_DMA, WAVE_STREAM, DMA_SxCR_DIR_MEM_TO_PERIPHERAL);
+	dma_set_memory_size(WAVE_DMA, WAVE_STREAM, DMA_SxCR_MSIZE_32BIT);
+	dma_set_peripheral_size(WAVE_DMA, WAVE_STREAM, DMA_SxCR_PSIZE_32BIT);
+	dma_enable_memory_increment_mode(WAVE_DMA, WAVE_STREAM);
+	dma_disable_peripheral_increment_mode(WAVE_DMA, WAVE_STREAM);
+	dma_enable_direct_mode(WAVE_DMA, WAVE_STREAM);
+	// Double buffer mode implies circular mode. Both targets point to the same pattern
+	// until swap is requested
+	dma_enable_double_buffer_mode(WAVE_DMA, WAVE_STREAM);
+	dma_set_peripheral_address(WAVE_DMA, WAVE_STREAM,
+							   (uint32_t)&GPIO_BSRR(sk_pin_port_to_gpio(port)));
+	wave_set_addresses(buf0, buf0);
+	dma_set_number_of_data(WAVE_DMA, WAVE_STREAM, len);
+
+	nvic_enable_irq(WAVE_IRQ);
+	return SK_EOK;
+}
+
+
+void sk_wave_start(struct sk_wave *wave)
+{
+	if ((NULL == wave) || (wave != active_wave) || wave->__isrunning)
+		return;
+
+	wave->__isrunning = true;
+	__DMB();	// make sure pattern is in memory before DMA starts reading it
+	dma_enable_stream(WAVE_DMA, WAVE_STREAM);
+	timer_enable_counter(WAVE_TIM);
+}
+
+
+void sk_wave_stop(struct sk_wave *wave)
+{
+	if ((NULL == wave) || (wave != active_wave) || !wave->__isrunning)
+		return;
+
+	timer_disable_counter(WAVE_TIM);
+	dma_disable_stream(WAVE_DMA, WAVE_STREAM);
+	while (DMA_SCR(WAVE_DMA, WAVE_STREAM) & DMA_SxCR_EN);	// EN clears when stream stops
+	dma_disable_transfer_complete_interrupt(WAVE_DMA, WAVE_STREAM);
+
+	// Finish pending swap right away and rewind. Stream restarts from M0AR
+	if (wave->__swapstage)
+		wave->__front = !wave->__front;
+	wave->__swapstage = 0;
+	wave->__isrunning = false;
+	uint32_t *front = wave->buf[wave->__front];
+	wave_set_addresses(front, front);
+	dma_set_number_of_data(WAVE_DMA, WAVE_STREAM, wave->len);
+}
+
+
+uint32_t *sk_wave_get_back(struct sk_wave *wave)
+{
+	if ((NULL == wave) || wave->__swapstage)
+		return NULL;
+	return wave->buf[!wave->__front];
+}
+
+
+sk_err sk_wave_swap(struct sk_wave *wave)
+{
+	if (NULL == wave)
+		return SK_EWRONGARG;
+	if (wave->__swapstage)
+		return SK_EUNAVAILABLE;
+
+	__DMB();	// back buffer contents must be written before DMA can see it
+
+	if ((wave != active_wave) || !wave->__isrunning) {
+		// Stream is not running, so both address registers are safe to write
+		wave->__front = !wave->__front;
+		uint32_t *front = wave->buf[wave->__front];
+		if (wave == active_wave)
+			wave_set_addresses(front, front);
+		return SK_EOK;
+	}
+
+	// Address register currently in use by DMA can not be written. So let ISR do it at the
+	// end of each of the next two transfers: each time for register just released by DMA
+	wave->__swapstage = 2;
+	dma_clear_interrupt_flags(WAVE_DMA, WAVE_STREAM, DMA_TCIF);
+	dma_enable_transfer_complete_interrupt(WAVE_DMA, WAVE_STREAM);
+	return SK_EOK;
+}
+
+
+void sk_wave_pattern_clear(uint32_t *buf, uint16_t len)
+{
+	for (uint16_t i = 0; i < len; i++)
+		buf[i] = 0;
+}
+
+
+void sk_wave_pattern_pwm(uint32_t *buf, uint16_t len, uint16_t pins, uint16_t duty)
+{
+	uint32_t both = ((uint32_t)pins << 16) | pins;
+	for (uint16_t i = 0; i < len; i++) {
+		// set pins for the first `duty` steps and reset them for the rest
+		uint32_t word = (i < duty) ? pins : ((uint32_t)pins << 16);
+		buf[i] = (buf[i] & ~both) | word;
+	}
+}
+
+
+void __sk_wave_dma_callback(void)
+{
+	if (!dma_get_interrupt_flag(WAVE_DMA, WAVE_STREAM, DMA_TCIF))
+		return;
+	dma_clear_interrupt_flags(WAVE_DMA, WAVE_STREAM, DMA_TCIF);
+
+	struct sk_wave *wave = active_wave;
+	if ((NULL == wave) || !wave->__swapstage) {
+		dma_disable_transfer_complete_interrupt(WAVE_DMA, WAVE_STREAM);
+		return;
+	}
+
+	// DMA has just switched targets. The one not in use now is free to be written
+	uint32_t *back = wave->buf[!wave->__front];
+	if (dma_get_target(WAVE_DMA, WAVE_STREAM))
+		dma_set_memory_address(WAVE_DMA, WAVE_STREAM, (uint32_t)back);
+	else
+		dma_set_memory_address_1(WAVE_DMA, WAVE_STREAM, (uint32_t)back);
+
+	if (2 == wave->__swapstage) {
+		// next pattern period will output new buffer
+		wave->__swapstage = 1;
+		return;
+	}
+
+	// both registers point to the new buffer now
+	wave->__front = !wave->__front;
+	wave->__swapstage = 0;
+	dma_disable_transfer_complete_interrupt(WAVE_DMA, WAVE_STREAM);
+}
+
+
+// DMA2 Stream 1 default ISR. May be overriden by user.
+void sk_attr_weak dma2_stream1_isr(void)
+{
+	__sk_wave_dma_callback();
+}
@@ -0,0 +1,113 @@
+/**
+ * sk_mpmc stress test
+ *
+ * Several producer threads put tagged sequence numbers into a small queue, while several
+ * consumer threads take them out. Exclusives are emulated with compare-exchange
+ * (see shim/intrinsics.h), so threads racing for the same position behave as contexts
+ * preempting each other on MCU.
+ *
+ * Checked: every element is taken exactly once (sums and counts match) and elements of
+ * each producer are seen by every consumer in the order they were put.
+ */
+
+#include "mpmc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+#define NPRODUCERS	4
+#define NCONSUMERS	4
+#define NPERPRODUCER	200000
+#define QUEUE_LEN	64
+/** Number of empty polls after all producers are done, before consumer gives up */
+#define MAX_IDLE	100000
+
+
+static sk_mpmc queue;
+static uint64_t queue_buf[QUEUE_LEN];
+static uint32_t queue_seq[QUEUE_LEN];
+
+static atomic_uint_fast64_t sum_in, sum_out;
+static atomic_uint nreceived;
+static atomic_uint nfinished;
+static atomic_bool isfailed;
+
+
+/** Element holds producer id in upper half and 1-based sequence number in lower half */
+static void *producer(void *arg)
+{
+	uint64_t id = (uintptr_t)arg;
+	uint64_t sum = 0;
+	for (uint32_t i = 1; i <= NPERPRODUCER; i++) {
+		uint64_t el = (id << 32) | i;
+		while (SK_EOK != sk_mpmc_put(&queue, &el))
+			sched_yield();
+		sum += el;
+	}
+	sum_in += sum;
+	nfinished++;
+	return NULL;
+}
+
+
+static void *consumer(void *arg)
+{
+	uintptr_t id = (uintptr_t)arg;
+	uint32_t lastseen[NPRODUCERS] = { 0 };
+	uint64_t sum = 0;
+	uint32_t nidle = 0;
+	while (nreceived < NPRODUCERS * NPERPRODUCER) {
+		uint64_t el;
+		if (SK_EOK != sk_mpmc_get(&queue, &el)) {
+			// everything was put long ago, but still not received. Elements were lost
+			if ((NPRODUCERS == nfinished) && (++nidle > MAX_IDLE))
+				break;
+			sched_yield();
+			continue;
+		}
+		nidle = 0;
+		uint32_t prod = el >> 32;
+		uint32_t seq = (uint32_t)el;
+		if ((prod >= NPRODUCERS) || (seq <= lastseen[prod])) {
+			printf("consumer %u: got %u:%u after %u\n", (unsigned)id, prod, seq,
+				   (prod < NPRODUCERS) ? lastseen[prod] : 0);
+			isfailed = true;
+		} else {
+			lastseen[prod] = seq;
+		}
+		sum += el;
+		nreceived++;
+	}
+	sum_out += sum;
+	return NULL;
+}
+
+
+int main(void)
+{
+	if (SK_EOK != sk_mpmc_init(&queue, queue_buf, queue_seq, QUEUE_LEN, sizeof(uint64_t))) {
+		printf("init failed\n");
+		return EXIT_FAILURE;
+	}
+
+	pthread_t threads[NPRODUCERS + NCONSUMERS];
+	for (uintptr_t i = 0; i < NPRODUCERS; i++)
+		pthread_create(&threads[i], NULL, producer, (void *)i);
+	for (uintptr_t i = 0; i < NCONSUMERS; i++)
+		pthread_create(&threads[NPRODUCERS + i], NULL, consumer, (void *)i);
+	for (int i = 0; i < NPRODUCERS + NCONSUMERS; i++)
+		pthread_join(threads[i], NULL);
+
+	uint64_t in = sum_in, out = sum_out;
+	bool isok = !isfailed && (in == out) && (nreceived == NPRODUCERS * NPERPRODUCER) &&
+				(0 == sk_mpmc_get_used(&queue));
+	printf("%s: %u elements, sum in %llu, out %llu, left %u\n", isok ? "OK" : "FAIL",
+		   (unsigned)nreceived, (unsigned long long)in, (unsigned long long)out,
+		   (unsigned)sk_mpmc_get_used(&queue));
+	return isok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
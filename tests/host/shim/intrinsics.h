@@ -0,0 +1,85 @@
+#pragma once
+/**
+ * Host replacement for libsk intrinsics
+ *
+ * Barriers map to C11 fences. Exclusive load/store pair is emulated with compare-exchange:
+ * exclusive load remembers the value it has read, and exclusive store succeeds only if memory
+ * still holds it. Unlike real exclusive monitor this misses changes which bring the value back
+ * (ABA). That is fine for libsk, where exclusives guard counters and queue positions
+ */
+
+#include "macro.h"
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/**
+ * Value seen by the last exclusive load of the current thread (private)
+ * Weak, so that every translation unit may define it, as with inline functions below
+ */
+sk_attr_weak _Thread_local uint32_t __host_excl_val;
+
+
+// Functions are non-static inline, same as libsk ones. Otherwise they could not be used
+// from inline functions of library headers
+
+// There are no interrupts or events on host. Give CPU to other threads instead of sleeping
+inline sk_attr_alwaysinline void __WFI(void) { sched_yield(); }
+inline sk_attr_alwaysinline void __WFE(void) { sched_yield(); }
+inline sk_attr_alwaysinline void __SEV(void) { }
+
+inline sk_attr_alwaysinline void __DMB(void) { atomic_thread_fence(memory_order_seq_cst); }
+inline sk_attr_alwaysinline void __DSB(void) { atomic_thread_fence(memory_order_seq_cst); }
+
+inline sk_attr_alwaysinline void __CLREX(void) { }
+
+
+/** Define host exclusive load/store for a single type (private) */
+#define __HOST_EXCL_DEFINE(sfx, type)							\
+inline sk_attr_alwaysinline type __LDREX##sfx(volatile type *addr)					\
+{											\
+	type val = __atomic_load_n(addr, __ATOMIC_SEQ_CST);				\
+	__host_excl_val = val;								\
+	return val;									\
+}											\
+inline sk_attr_alwaysinline uint32_t __STREX##sfx(type val, volatile type *addr)			\
+{											\
+	type expected = (type)__host_excl_val;						\
+	return !__atomic_compare_exchange_n(addr, &expected, val, false,		\
+					    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);	\
+}
+
+__HOST_EXCL_DEFINE(B, uint8_t)
+__HOST_EXCL_DEFINE(H, uint16_t)
+__HOST_EXCL_DEFINE(W, uint32_t)
+
+
+/** Define host compare-and-swap for a single type (private) */
+#define __HOST_CAS_DEFINE(sfx, type)							\
+inline sk_attr_alwaysinline bool __host_cas_##sfx(volatile type *ptr, type expected, type desired)	\
+{											\
+	return __atomic_compare_exchange_n(ptr, &expected, desired, false,		\
+					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);		\
+}
+
+__HOST_CAS_DEFINE(u8, uint8_t)
+__HOST_CAS_DEFINE(u16, uint16_t)
+__HOST_CAS_DEFINE(u32, uint32_t)
+
+
+// Same semantics as libsk ones: sequentially consistent, read-modify-write returns old value
+#define sk_atomic_load(ptr)		__atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define sk_atomic_store(ptr, val)	__atomic_store_n((ptr), (val), __ATOMIC_SEQ_CST)
+#define sk_atomic_xchg(ptr, val)	__atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+#define sk_atomic_add(ptr, val)		__atomic_fetch_add((ptr), (val), __ATOMIC_SEQ_CST)
+#define sk_atomic_sub(ptr, val)		__atomic_fetch_sub((ptr), (val), __ATOMIC_SEQ_CST)
+#define sk_atomic_or(ptr, val)		__atomic_fetch_or((ptr), (val), __ATOMIC_SEQ_CST)
+#define sk_atomic_and(ptr, val)		__atomic_fetch_and((ptr), (val), __ATOMIC_SEQ_CST)
+#define sk_atomic_cas(ptr, expected, desired)						\
+	_Generic((ptr),									\
+		uint8_t *: __host_cas_u8, volatile uint8_t *: __host_cas_u8,		\
+		uint16_t *: __host_cas_u16, volatile uint16_t *: __host_cas_u16,	\
+		uint32_t *: __host_cas_u32, volatile uint32_t *: __host_cas_u32		\
+	)((ptr), (expected), (desired))
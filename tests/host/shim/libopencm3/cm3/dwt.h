@@ -0,0 +1,20 @@
+#pragma once
+/**
+ * Host replacement for libopencm3 DWT definitions
+ *
+ * Cycle counter is read-only here and counts nanoseconds of monotonic clock
+ */
+
+#include "macro.h"
+#include <stdint.h>
+#include <time.h>
+
+
+inline sk_attr_alwaysinline uint32_t __host_dwt_cyccnt(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)ts.tv_sec * 1000000000u + (uint32_t)ts.tv_nsec;
+}
+
+#define DWT_CYCCNT	(__host_dwt_cyccnt())
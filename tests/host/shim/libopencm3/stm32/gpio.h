@@ -0,0 +1,67 @@
+#pragma once
+/**
+ * Host replacement for libopencm3 GPIO definitions
+ *
+ * Registers keep their real addresses. Test maps plain memory there (see host_periph_map()),
+ * so library code reads and writes them as usual, but no side effects happen: i.e. writes
+ * to BSRR do not change ODR
+ */
+
+#include "macro.h"
+#include <stdint.h>
+
+
+#define MMIO32(addr)		(*(volatile uint32_t *)(uintptr_t)(addr))
+
+#define GPIO_PORT_A_BASE	0x40020000u
+#define GPIO_PORT_B_BASE	0x40020400u
+
+#define GPIO_MODER(port)	MMIO32((port) + 0x00)
+#define GPIO_OTYPER(port)	MMIO32((port) + 0x04)
+#define GPIO_OSPEEDR(port)	MMIO32((port) + 0x08)
+#define GPIO_PUPDR(port)	MMIO32((port) + 0x0c)
+#define GPIO_IDR(port)		MMIO32((port) + 0x10)
+#define GPIO_ODR(port)		MMIO32((port) + 0x14)
+#define GPIO_BSRR(port)		MMIO32((port) + 0x18)
+#define GPIO_AFRL(port)		MMIO32((port) + 0x20)
+#define GPIO_AFRH(port)		MMIO32((port) + 0x24)
+
+#define GPIO_MODE_INPUT		0x0
+#define GPIO_MODE_OUTPUT	0x1
+#define GPIO_MODE_AF		0x2
+#define GPIO_MODE_ANALOG	0x3
+
+#define GPIO_PUPD_NONE		0x0
+#define GPIO_PUPD_PULLUP	0x1
+#define GPIO_PUPD_PULLDOWN	0x2
+
+#define GPIO_OTYPE_PP		0x0
+#define GPIO_OTYPE_OD		0x1
+
+#define GPIO_OSPEED_2MHZ	0x0
+#define GPIO_OSPEED_25MHZ	0x1
+#define GPIO_OSPEED_50MHZ	0x2
+#define GPIO_OSPEED_100MHZ	0x3
+
+
+// Same as libopencm3 ones, made inline so that no library is needed
+inline sk_attr_alwaysinline uint16_t gpio_port_read(uint32_t gpioport)
+{
+	return GPIO_IDR(gpioport);
+}
+
+inline sk_attr_alwaysinline void gpio_set(uint32_t gpioport, uint16_t gpios)
+{
+	GPIO_BSRR(gpioport) = gpios;
+}
+
+inline sk_attr_alwaysinline void gpio_clear(uint32_t gpioport, uint16_t gpios)
+{
+	GPIO_BSRR(gpioport) = (uint32_t)gpios << 16;
+}
+
+inline sk_attr_alwaysinline void gpio_toggle(uint32_t gpioport, uint16_t gpios)
+{
+	uint32_t port = GPIO_ODR(gpioport);
+	GPIO_BSRR(gpioport) = ((port & gpios) << 16) | (~port & gpios);
+}
@@ -0,0 +1,8 @@
+#pragma once
+/** Host replacement for libopencm3 RCC definitions. Only registers used by libsk */
+
+#include <libopencm3/stm32/gpio.h>
+
+
+#define RCC_BASE		0x40023800u
+#define RCC_AHB1ENR		MMIO32(RCC_BASE + 0x30)